@@ -18,6 +18,8 @@ Item {
 
     ProgressModel {
         id: customProgressModel
+
+        demoThrottle: progressThrottle
     }
 
     ListView {
@@ -53,12 +55,13 @@ Item {
         target: customProgressModel
         function onProgressChanged(value) {
             progressBar.visible = true;
-            if (value < progressBar.to - 1) {
-                progressBar.value = value;
-            }
-            else {
-                progressBar.visible = false;
-                progressBar.value = 1;
+            progressBar.value = value;
+        }
+        function onCompleted(succeeded) {
+            progressBar.visible = false;
+            progressBar.value = 1;
+            // Failed jobs report their errors themselves
+            if (succeeded) {
                 customDialogManager.showDialog({
                     title: "Message",
                     message: "Operation Success"
@@ -0,0 +1,43 @@
+// Copyright PocketBook - Interview Task
+
+#include "bitreader.h"
+
+namespace PocketBook {
+
+BitReader::BitReader(const std::uint8_t * _data, std::size_t _numBytes)
+    : m_data(_data), m_numBytes(_numBytes)
+{
+}
+
+void BitReader::seek(std::size_t _bitPos)
+{
+    m_bitPos = _bitPos;
+}
+
+std::size_t BitReader::position() const
+{
+    return m_bitPos;
+}
+
+std::size_t BitReader::sizeInBits() const
+{
+    return m_numBytes * 8;
+}
+
+bool BitReader::overrun() const
+{
+    return m_bitPos > sizeInBits();
+}
+
+std::uint64_t BitReader::peekTail() const
+{
+    const std::size_t bytePos = m_bitPos >> 3;
+    if(bytePos >= m_numBytes)
+        return 0;
+
+    std::uint64_t word = 0;
+    memcpy(&word, m_data + bytePos, m_numBytes - bytePos);
+    return word >> (m_bitPos & 7);
+}
+
+} // namespace PocketBook
@@ -0,0 +1,55 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace PocketBook {
+
+// BitReader reads LSB first bit stream produced by BitWriter.
+// It doesn't own nor copy the data, so it can work directly over mapped file.
+class BitReader
+{
+public:
+    BitReader(const std::uint8_t * _data /* non-owning */, std::size_t _numBytes);
+
+    // Returns at least 57 next bits starting from the lowest one.
+    // Bits beyond the end of the stream are read as zeros.
+    std::uint64_t peek() const;
+
+    void skip(unsigned _count);
+    void seek(std::size_t _bitPos);
+
+    std::size_t position() const;
+    std::size_t sizeInBits() const;
+
+    // True when more bits were consumed than the stream contains
+    bool overrun() const;
+
+private:
+    std::uint64_t peekTail() const;
+
+    const std::uint8_t * m_data;
+    std::size_t m_numBytes;
+    std::size_t m_bitPos = 0;
+};
+
+inline std::uint64_t BitReader::peek() const
+{
+    const std::size_t bytePos = m_bitPos >> 3;
+    if(bytePos + sizeof(std::uint64_t) > m_numBytes)
+        return peekTail();
+
+    std::uint64_t word;
+    memcpy(&word, m_data + bytePos, sizeof(word)); // Unaligned little endian load
+    return word >> (m_bitPos & 7);
+}
+
+inline void BitReader::skip(unsigned _count)
+{
+    m_bitPos += _count;
+}
+
+} // namespace PocketBook
@@ -0,0 +1,71 @@
+// Copyright PocketBook - Interview Task
+
+#include "bitwriter.h"
+
+#include <algorithm>
+
+namespace PocketBook {
+
+BitWriter::BitWriter(std::size_t _reserveBytes)
+    : m_buffer(std::max<std::size_t>(_reserveBytes, sizeof(std::uint32_t)), 0x00)
+{
+}
+
+void BitWriter::flush()
+{
+    while(m_fill > 0)
+    {
+        if(m_bytePos == m_buffer.size())
+            grow();
+
+        m_buffer[m_bytePos++] = static_cast<std::uint8_t>(m_accumulator);
+        m_accumulator >>= 8;
+        m_fill = m_fill > 8 ? m_fill - 8 : 0;
+    }
+    m_accumulator = 0;
+}
+
+std::size_t BitWriter::sizeInBits() const
+{
+    return m_bytePos * 8 + m_fill;
+}
+
+std::size_t BitWriter::numBytes() const
+{
+    return m_bytePos + (m_fill + 7) / 8;
+}
+
+std::size_t BitWriter::numCompleteBytes() const
+{
+    return m_bytePos;
+}
+
+void BitWriter::discardCompleteBytes()
+{
+    m_bytePos = 0;
+}
+
+std::size_t BitWriter::capacity() const
+{
+    return m_buffer.size();
+}
+
+const std::uint8_t * BitWriter::data() const
+{
+    return m_buffer.data();
+}
+
+std::vector<std::uint8_t> BitWriter::release()
+{
+    flush();
+    m_buffer.resize(m_bytePos);
+    m_bytePos = 0;
+    return std::move(m_buffer);
+}
+
+void BitWriter::grow()
+{
+    m_buffer.resize(m_buffer.size() << 1, 0x00); // Resize buffer x2 as DynamicBitset does
+}
+
+} // namespace PocketBook
@@ -0,0 +1,90 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace PocketBook {
+
+// BitWriter appends bits LSB first into a growing byte buffer.
+// Bits are collected in a 64-bit accumulator and flushed as whole 32-bit words,
+// so the produced stream is bit-compatible with DynamicBitset::set() sequence.
+class BitWriter
+{
+public:
+    explicit BitWriter(std::size_t _reserveBytes = 0);
+
+    // Appends the lowest _count bits of _bits, _count must be <= 32
+    // and all bits above _count must be zero
+    void put(std::uint32_t _bits, unsigned _count);
+
+    // Appends _count zero bits
+    void putZeros(std::size_t _count);
+
+    // Writes pending bits padding the last byte with zeros
+    void flush();
+
+    std::size_t sizeInBits() const;
+    std::size_t numBytes() const;
+
+    // Bytes at data() that won't change anymore, pending bits stay in accumulator
+    std::size_t numCompleteBytes() const;
+
+    // Drops complete bytes already consumed by the caller, so the buffer can be reused
+    void discardCompleteBytes();
+
+    // Bytes allocated for the buffer
+    std::size_t capacity() const;
+
+    const std::uint8_t * data() const;
+    std::vector<std::uint8_t> release();
+
+private:
+    void flushWord();
+    void grow();
+
+    std::vector<std::uint8_t> m_buffer;
+    std::size_t m_bytePos = 0;
+    std::uint64_t m_accumulator = 0;
+    unsigned m_fill = 0;
+};
+
+inline void BitWriter::put(std::uint32_t _bits, unsigned _count)
+{
+    m_accumulator |= static_cast<std::uint64_t>(_bits) << m_fill;
+    m_fill += _count;
+    if(m_fill >= 32)
+        flushWord();
+}
+
+inline void BitWriter::putZeros(std::size_t _count)
+{
+    // Accumulator bits above m_fill are always zero
+    m_fill += static_cast<unsigned>(_count % 32);
+    if(m_fill >= 32)
+        flushWord();
+
+    for(std::size_t words = _count / 32; words > 0; --words)
+    {
+        m_fill += 32;
+        flushWord();
+    }
+}
+
+inline void BitWriter::flushWord()
+{
+    if(m_bytePos + sizeof(std::uint32_t) > m_buffer.size())
+        grow();
+
+    // Little endian layout keeps LSB first bit order of the stream
+    const auto word = static_cast<std::uint32_t>(m_accumulator);
+    memcpy(m_buffer.data() + m_bytePos, &word, sizeof(word));
+    m_bytePos += sizeof(word);
+    m_accumulator >>= 32;
+    m_fill -= 32;
+}
+
+} // namespace PocketBook
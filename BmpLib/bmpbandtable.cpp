@@ -0,0 +1,136 @@
+// Copyright PocketBook - Interview Task
+
+#include "bmpbandtable.h"
+#include "bmpdefs.h"
+#include "bmpexceptions.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace PocketBook {
+
+namespace {
+
+// Bands are aligned to index blocks, so each band owns whole bytes of BmpRowIndex
+static constexpr std::uint32_t BAND_ROWS_ALIGNMENT = 8;
+
+// Number of bands per thread used when rows per band is chosen automatically
+static constexpr unsigned BANDS_PER_THREAD = 4;
+
+// Upper limit of raw band size when rows per band is chosen automatically,
+// keeps memory of concurrently encoded bands independent of image size
+static constexpr std::size_t MAX_AUTO_BAND_BYTES = 4 * 1024 * 1024;
+
+std::uint32_t alignRowsPerBand(std::size_t _rows)
+{
+    const std::size_t aligned = (_rows + BAND_ROWS_ALIGNMENT - 1) / BAND_ROWS_ALIGNMENT * BAND_ROWS_ALIGNMENT;
+    return static_cast<std::uint32_t>(std::max<std::size_t>(aligned, BAND_ROWS_ALIGNMENT));
+}
+
+} // namespace
+
+BmpBandTable::BmpBandTable(std::uint32_t _rowsPerBand, std::vector<std::uint32_t> && _offsets)
+    : m_rowsPerBand(_rowsPerBand), m_offsets(std::move(_offsets))
+{
+}
+
+std::uint32_t BmpBandTable::getRowsPerBand() const
+{
+    return m_rowsPerBand;
+}
+
+std::size_t BmpBandTable::getBandCount() const
+{
+    return m_offsets.size();
+}
+
+std::uint32_t BmpBandTable::getBandOffset(std::size_t _band) const
+{
+    return m_offsets.at(_band);
+}
+
+std::size_t BmpBandTable::getBandFirstRow(std::size_t _band) const
+{
+    return _band * m_rowsPerBand;
+}
+
+std::size_t BmpBandTable::getBandRowCount(std::size_t _band, std::size_t _height) const
+{
+    const std::size_t firstRow = getBandFirstRow(_band);
+    return firstRow < _height ? std::min<std::size_t>(m_rowsPerBand, _height - firstRow) : 0;
+}
+
+std::vector<std::uint8_t> BmpBandTable::serialize() const
+{
+    const auto bandCount = static_cast<std::uint32_t>(m_offsets.size());
+
+    BarchChunkHeader chunkHeader;
+    chunkHeader.Tag = BAND_TABLE_TAG;
+    chunkHeader.Size = static_cast<std::uint32_t>(sizeof(m_rowsPerBand) + sizeof(bandCount) + bandCount * sizeof(std::uint32_t));
+
+    std::vector<std::uint8_t> chunk(sizeof(chunkHeader) + chunkHeader.Size);
+    std::uint8_t * chunkPtr = chunk.data();
+    memcpy(chunkPtr, &chunkHeader, sizeof(chunkHeader));
+    chunkPtr += sizeof(chunkHeader);
+    memcpy(chunkPtr, &m_rowsPerBand, sizeof(m_rowsPerBand));
+    chunkPtr += sizeof(m_rowsPerBand);
+    memcpy(chunkPtr, &bandCount, sizeof(bandCount));
+    chunkPtr += sizeof(bandCount);
+    memcpy(chunkPtr, m_offsets.data(), bandCount * sizeof(std::uint32_t));
+
+    return chunk;
+}
+
+std::size_t BmpBandTable::getBandCount(std::size_t _height, std::uint32_t _rowsPerBand)
+{
+    // Image without rows still has single empty band, so band count is never zero
+    return _rowsPerBand == 0 ? 1 : std::max<std::size_t>((_height + _rowsPerBand - 1) / _rowsPerBand, 1);
+}
+
+std::uint32_t BmpBandTable::calculateRowsPerBand(std::size_t _height, std::size_t _rowSize, unsigned _threadCount, std::uint32_t _requested)
+{
+    if(_requested != 0)
+        return alignRowsPerBand(_requested);
+
+    if(_threadCount <= 1)
+        return 0;
+
+    const std::size_t rows = (_height + _threadCount * BANDS_PER_THREAD - 1) / (_threadCount * BANDS_PER_THREAD);
+    const std::size_t maxRows = MAX_AUTO_BAND_BYTES / std::max<std::size_t>(_rowSize, 1) / BAND_ROWS_ALIGNMENT * BAND_ROWS_ALIGNMENT;
+    return alignRowsPerBand(std::min(rows, maxRows));
+}
+
+BmpBandTable BmpBandTable::createFromChunk(
+        const std::uint8_t * _payload
+    ,   std::size_t _payloadSize
+    ,   std::size_t _height
+    ,   std::size_t _compressedSize
+    )
+{
+    std::uint32_t rowsPerBand = 0;
+    std::uint32_t bandCount = 0;
+    if(_payloadSize < sizeof(rowsPerBand) + sizeof(bandCount))
+        throw InvalidPixelDataError("Band table is truncated");
+
+    memcpy(&rowsPerBand, _payload, sizeof(rowsPerBand));
+    memcpy(&bandCount, _payload + sizeof(rowsPerBand), sizeof(bandCount));
+
+    if(rowsPerBand == 0 || bandCount != getBandCount(_height, rowsPerBand))
+        throw InvalidPixelDataError(std::string("Unexpected band count: ") + std::to_string(bandCount));
+
+    if(_payloadSize < sizeof(rowsPerBand) + sizeof(bandCount) + bandCount * sizeof(std::uint32_t))
+        throw InvalidPixelDataError("Band table is truncated");
+
+    std::vector<std::uint32_t> offsets(bandCount);
+    memcpy(offsets.data(), _payload + sizeof(rowsPerBand) + sizeof(bandCount), bandCount * sizeof(std::uint32_t));
+
+    for(std::size_t band = 0; band < offsets.size(); ++band)
+    {
+        if(offsets[band] > _compressedSize || (band > 0 && offsets[band] < offsets[band - 1]))
+            throw InvalidPixelDataError(std::string("Invalid band offset: ") + std::to_string(offsets[band]));
+    }
+
+    return BmpBandTable(rowsPerBand, std::move(offsets));
+}
+
+} // namespace PocketBook
@@ -0,0 +1,49 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace PocketBook {
+
+// BmpBandTable describes compressed pixel data split into bands of rows.
+// Each band starts at byte boundary, so it can be encoded and decoded independently.
+// The table is stored in barch file as BAND_TABLE_TAG chunk right after Index Data:
+// RowsPerBand (4 bytes), BandCount (4 bytes), BandCount x band offset (4 bytes)
+// where band offset is relative to the start of compressed Pixel Data.
+class BmpBandTable
+{
+public:
+    BmpBandTable(std::uint32_t _rowsPerBand, std::vector<std::uint32_t> && _offsets);
+
+    std::uint32_t getRowsPerBand() const;
+    std::size_t getBandCount() const;
+    std::uint32_t getBandOffset(std::size_t _band) const;
+
+    std::size_t getBandFirstRow(std::size_t _band) const;
+    std::size_t getBandRowCount(std::size_t _band, std::size_t _height) const;
+
+    // Returns table serialized as barch chunk including chunk header
+    std::vector<std::uint8_t> serialize() const;
+
+    // Returns at least 1 band, even for image without rows
+    static std::size_t getBandCount(std::size_t _height, std::uint32_t _rowsPerBand);
+
+    // Returns rows per band to use for encoding, 0 when image shouldn't be split
+    static std::uint32_t calculateRowsPerBand(std::size_t _height, std::size_t _rowSize, unsigned _threadCount, std::uint32_t _requested);
+
+    static BmpBandTable createFromChunk(
+            const std::uint8_t * _payload
+        ,   std::size_t _payloadSize
+        ,   std::size_t _height
+        ,   std::size_t _compressedSize
+    );
+
+private:
+    std::uint32_t m_rowsPerBand;
+    std::vector<std::uint32_t> m_offsets;
+};
+
+} // namespace PocketBook
@@ -0,0 +1,433 @@
+// Copyright PocketBook - Interview Task
+
+#include "bmpbatch.h"
+#include "bmpiouring.h"
+#include "bmpproxy.h"
+#include "bmpexceptions.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+#ifdef POCKETBOOK_HAS_IO_URING
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace PocketBook {
+
+namespace {
+
+BatchJobResult MakeFailure(const std::string & _message)
+{
+    BatchJobResult result;
+    result.ErrorMessage = _message;
+    return result;
+}
+
+std::string GetFailureMessage(const BatchJob & _job, const CodecOptions & _options)
+{
+    const bool cancelled = (_options.Cancellation && _options.Cancellation->isCancelled()) ||
+                           std::chrono::steady_clock::now() >= _options.Deadline;
+    if(cancelled)
+        return "Operation cancelled";
+
+    return _job.Compress ? "Unable to compress file" : "Unable to decompress file";
+}
+
+bool ConvertInMemory(const BatchJob & _job, const std::uint8_t * _input, std::size_t _size, std::vector<std::uint8_t> & _output, const CodecOptions & _options)
+{
+    if(_job.Compress)
+        return BmpProxy::createFromBmp(_input, _size).compress(_output, nullptr, _options);
+    else
+        return BmpProxy::createFromBarch(_input, _size).decompress(_output, nullptr, _options);
+}
+
+} // namespace
+
+BatchConverter::BatchConverter(const BatchOptions & _options)
+    : m_options(_options)
+{
+    m_options.QueueDepth = std::max(m_options.QueueDepth, 1u);
+
+    if(m_options.PreferIoUring)
+    {
+        m_ring = std::make_unique<IoUring>();
+        if(!m_ring->init(m_options.QueueDepth))
+            m_ring.reset();
+    }
+}
+
+BatchConverter::~BatchConverter() = default;
+
+BatchIoBackend BatchConverter::getBackend() const
+{
+    return m_ring ? BatchIoBackend::IoUring : BatchIoBackend::Blocking;
+}
+
+std::vector<BatchJobResult> BatchConverter::run(const std::vector<BatchJob> & _jobs, const JobFinishedCallback & _onJobFinished)
+{
+    std::vector<BatchJobResult> results(_jobs.size());
+    if(m_ring)
+        runIoUring(_jobs, results, _onJobFinished);
+    else
+        runBlocking(_jobs, results, _onJobFinished);
+
+    return results;
+}
+
+void BatchConverter::runBlocking(const std::vector<BatchJob> & _jobs, std::vector<BatchJobResult> & _results, const JobFinishedCallback & _onJobFinished)
+{
+    for(std::size_t jobIndex = 0; jobIndex < _jobs.size(); ++jobIndex)
+    {
+        _results[jobIndex] = runBlockingJob(_jobs[jobIndex]);
+        if(_onJobFinished)
+            _onJobFinished(jobIndex, _results[jobIndex]);
+    }
+}
+
+BatchJobResult BatchConverter::runBlockingJob(const BatchJob & _job) const
+{
+    const auto start = std::chrono::steady_clock::now();
+    BatchJobResult result;
+    CodecOptions codecOptions = m_options.Codec;
+    codecOptions.Statistics = &result.Statistics;
+    try
+    {
+        if(_job.Compress)
+            result.Succeeded = BmpProxy::createFromBmp(_job.InputPath).compress(_job.OutputPath, nullptr, codecOptions);
+        else
+            result.Succeeded = BmpProxy::createFromBarch(_job.InputPath).decompress(_job.OutputPath, nullptr, codecOptions);
+
+        if(!result.Succeeded)
+            result.ErrorMessage = GetFailureMessage(_job, m_options.Codec);
+    }
+    catch( const std::exception & _err )
+    {
+        result = MakeFailure(_err.what());
+    }
+
+    result.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+#ifdef POCKETBOOK_HAS_IO_URING
+
+void BatchConverter::runIoUring(const std::vector<BatchJob> & _jobs, std::vector<BatchJobResult> & _results, const JobFinishedCallback & _onJobFinished)
+{
+    enum class Stage { Free, Reading, Ready, Writing };
+
+    // Each slot has at most one request in flight, its index is used as request user data
+    struct Slot
+    {
+        Stage SlotStage = Stage::Free;
+        std::size_t JobIndex = 0;
+        std::chrono::steady_clock::time_point Start;
+        int FileDescriptor = -1;
+        // Buffers are kept for next jobs of the slot to avoid page faults of fresh memory.
+        // Input is allocated without zero initialization, it is overwritten by the read anyway
+        std::unique_ptr<std::uint8_t[]> Input;
+        std::size_t InputCapacity = 0;
+        std::vector<std::uint8_t> Output;
+        OperationStatistics Statistics;
+        std::size_t Size = 0;
+        std::size_t Transferred = 0;
+    };
+
+    std::vector<Slot> slots(m_options.QueueDepth);
+    std::size_t nextJob = 0;
+    std::size_t finishedJobs = 0;
+
+    auto finish = [&](Slot & _slot, const BatchJobResult & _result)
+    {
+        if(_slot.FileDescriptor >= 0)
+            close(_slot.FileDescriptor);
+
+        // Incomplete output is removed like BmpProxy does on failure
+        if(!_result.Succeeded && _slot.SlotStage == Stage::Writing)
+            remove(_jobs[_slot.JobIndex].OutputPath.c_str());
+
+        BatchJobResult & result = _results[_slot.JobIndex];
+        result = _result;
+        result.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _slot.Start).count();
+        if(_onJobFinished)
+            _onJobFinished(_slot.JobIndex, result);
+
+        _slot.SlotStage = Stage::Free;
+        _slot.FileDescriptor = -1;
+        _slot.Size = 0;
+        _slot.Transferred = 0;
+        ++finishedJobs;
+    };
+
+    auto queueTransfer = [&](std::size_t _slotIndex)
+    {
+        Slot & slot = slots[_slotIndex];
+        const std::size_t size = slot.Size - slot.Transferred;
+        const bool queued = slot.SlotStage == Stage::Reading
+            ? m_ring->queueRead(slot.FileDescriptor, slot.Input.get() + slot.Transferred, size, slot.Transferred, _slotIndex)
+            : m_ring->queueWrite(slot.FileDescriptor, slot.Output.data() + slot.Transferred, size, slot.Transferred, _slotIndex);
+        if(!queued)
+            throw std::runtime_error("io_uring submission queue is full");
+    };
+
+    auto startRead = [&](std::size_t _slotIndex, std::size_t _jobIndex)
+    {
+        Slot & slot = slots[_slotIndex];
+        slot.JobIndex = _jobIndex;
+        slot.Start = std::chrono::steady_clock::now();
+        slot.SlotStage = Stage::Reading;
+
+        const std::string & inputPath = _jobs[_jobIndex].InputPath;
+        slot.FileDescriptor = open(inputPath.c_str(), O_RDONLY | O_CLOEXEC);
+
+        struct stat statbuf;
+        if(slot.FileDescriptor < 0 || fstat(slot.FileDescriptor, &statbuf) < 0)
+            throw FileDoesntExistError(inputPath);
+
+        slot.Size = static_cast<std::size_t>(statbuf.st_size);
+        if(slot.Size == 0)
+            throw InvalidBmpHeaderError("File is empty");
+
+        if(slot.InputCapacity < slot.Size)
+        {
+            slot.Input.reset(new std::uint8_t[slot.Size]);
+            slot.InputCapacity = slot.Size;
+        }
+
+        queueTransfer(_slotIndex);
+    };
+
+    auto startWrite = [&](std::size_t _slotIndex)
+    {
+        Slot & slot = slots[_slotIndex];
+        const BatchJob & job = _jobs[slot.JobIndex];
+
+        close(slot.FileDescriptor);
+        slot.FileDescriptor = -1;
+
+        CodecOptions codecOptions = m_options.Codec;
+        codecOptions.Statistics = &slot.Statistics;
+        if(!ConvertInMemory(job, slot.Input.get(), slot.Size, slot.Output, codecOptions))
+            throw FileError(GetFailureMessage(job, m_options.Codec));
+
+        slot.Size = slot.Output.size();
+        slot.Transferred = 0;
+        slot.FileDescriptor = open(job.OutputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if(slot.FileDescriptor < 0)
+            throw FileCreationError(job.OutputPath);
+
+        slot.SlotStage = Stage::Writing;
+        if(slot.Size == 0)
+        {
+            BatchJobResult result;
+            result.Succeeded = true;
+            result.Statistics = slot.Statistics;
+            finish(slot, result);
+            return;
+        }
+        queueTransfer(_slotIndex);
+    };
+
+    auto complete = [&](std::size_t _slotIndex, std::int32_t _result)
+    {
+        Slot & slot = slots[_slotIndex];
+        const BatchJob & job = _jobs[slot.JobIndex];
+        const bool reading = slot.SlotStage == Stage::Reading;
+        if(_result <= 0)
+        {
+            if(reading)
+                throw FileOpeningError(job.InputPath);
+            throw FileCreationError(job.OutputPath);
+        }
+
+        // Short transfer is continued from where it stopped
+        slot.Transferred += static_cast<std::size_t>(_result);
+        if(slot.Transferred < slot.Size)
+        {
+            queueTransfer(_slotIndex);
+            return;
+        }
+
+        if(reading)
+        {
+            slot.SlotStage = Stage::Ready;
+        }
+        else
+        {
+            BatchJobResult result;
+            result.Succeeded = true;
+            result.Statistics = slot.Statistics;
+            finish(slot, result);
+        }
+    };
+
+    // Any failure of a stage fails only the job of that slot
+    auto runStage = [&](std::size_t _slotIndex, const std::function<void()> & _stage)
+    {
+        try
+        {
+            _stage();
+        }
+        catch( const std::exception & _err )
+        {
+            finish(slots[_slotIndex], MakeFailure(_err.what()));
+        }
+    };
+
+    // Kernel may still transfer into buffers of the slots, so every submitted request is cancelled
+    // and its completion is waited for before slots are released. Returns false when the ring
+    // can't deliver completions anymore, buffers of the slots must not be freed then.
+    auto drainRing = [&]
+    {
+        static constexpr std::uint64_t CANCEL_USER_DATA = ~std::uint64_t(0);
+
+        m_ring->discardUnsubmitted();
+        for(std::size_t slotIndex = 0; slotIndex < slots.size(); ++slotIndex)
+        {
+            const Stage stage = slots[slotIndex].SlotStage;
+            if(stage == Stage::Reading || stage == Stage::Writing)
+                m_ring->queueCancel(slotIndex, CANCEL_USER_DATA);
+        }
+
+        bool drained = true;
+        std::uint64_t userData = 0;
+        std::int32_t result = 0;
+        while(m_ring->getInFlight() > 0)
+        {
+            if(!m_ring->takeCompletion(userData, result, true))
+            {
+                drained = false;
+                break;
+            }
+        }
+        m_ring->discardUnsubmitted();
+        return drained;
+    };
+
+    // Closes files of busy slots and removes their incomplete outputs, returns their jobs
+    auto abandonSlots = [&](bool _drained)
+    {
+        std::vector<std::size_t> abandonedJobs;
+        for(auto & slot : slots)
+        {
+            if(slot.SlotStage == Stage::Free)
+                continue;
+
+            if(slot.FileDescriptor >= 0)
+                close(slot.FileDescriptor);
+            if(slot.SlotStage == Stage::Writing)
+                remove(_jobs[slot.JobIndex].OutputPath.c_str());
+            abandonedJobs.push_back(slot.JobIndex);
+
+            // Kernel may still own the buffers, leaking them is the only safe option
+            if(!_drained)
+            {
+                static_cast<void>(slot.Input.release());
+                static_cast<void>(new std::vector<std::uint8_t>(std::move(slot.Output)));
+            }
+            slot.SlotStage = Stage::Free;
+            slot.FileDescriptor = -1;
+        }
+        return abandonedJobs;
+    };
+
+    // Ring failure doesn't fail jobs, unfinished ones are converted again by blocking file API
+    // and the converter stays with blocking backend
+    auto recoverFromRingFailure = [&]
+    {
+        std::vector<std::size_t> unfinishedJobs = abandonSlots(drainRing());
+        for(; nextJob < _jobs.size(); ++nextJob)
+            unfinishedJobs.push_back(nextJob);
+
+        m_ring.reset();
+
+        std::sort(unfinishedJobs.begin(), unfinishedJobs.end());
+        for(const std::size_t jobIndex : unfinishedJobs)
+        {
+            _results[jobIndex] = runBlockingJob(_jobs[jobIndex]);
+            if(_onJobFinished)
+                _onJobFinished(jobIndex, _results[jobIndex]);
+        }
+    };
+
+    try
+    {
+        while(finishedJobs < _jobs.size())
+        {
+            // Keep the queue filled with reads of next inputs
+            for(std::size_t slotIndex = 0; slotIndex < slots.size() && nextJob < _jobs.size(); ++slotIndex)
+            {
+                if(slots[slotIndex].SlotStage != Stage::Free)
+                    continue;
+
+                const std::size_t jobIndex = nextJob++;
+                runStage(slotIndex, [&] { startRead(slotIndex, jobIndex); });
+            }
+
+            if(!m_ring->submit())
+            {
+                recoverFromRingFailure();
+                return;
+            }
+
+            // Collect finished transfers without waiting
+            std::uint64_t userData = 0;
+            std::int32_t result = 0;
+            while(m_ring->takeCompletion(userData, result, false))
+            {
+                const auto slotIndex = static_cast<std::size_t>(userData);
+                runStage(slotIndex, [&] { complete(slotIndex, result); });
+            }
+
+            // Convert the earliest ready job while other transfers are in flight
+            auto ready = std::min_element(slots.begin(), slots.end(), [](const Slot & _lhs, const Slot & _rhs)
+            {
+                if((_lhs.SlotStage == Stage::Ready) != (_rhs.SlotStage == Stage::Ready))
+                    return _lhs.SlotStage == Stage::Ready;
+                return _lhs.JobIndex < _rhs.JobIndex;
+            });
+            if(ready != slots.end() && ready->SlotStage == Stage::Ready)
+            {
+                const auto slotIndex = static_cast<std::size_t>(ready - slots.begin());
+                runStage(slotIndex, [&] { startWrite(slotIndex); });
+                continue;
+            }
+
+            const bool inFlight = std::any_of(slots.begin(), slots.end(), [](const Slot & _slot)
+            {
+                return _slot.SlotStage == Stage::Reading || _slot.SlotStage == Stage::Writing;
+            });
+            if(!inFlight)
+                continue;
+
+            if(!m_ring->takeCompletion(userData, result, true))
+            {
+                recoverFromRingFailure();
+                return;
+            }
+
+            const auto slotIndex = static_cast<std::size_t>(userData);
+            runStage(slotIndex, [&] { complete(slotIndex, result); });
+        }
+    }
+    catch( ... )
+    {
+        // Nothing may unwind slots while kernel still transfers into their buffers
+        if(m_ring)
+            abandonSlots(drainRing());
+        throw;
+    }
+}
+
+#else
+
+void BatchConverter::runIoUring(const std::vector<BatchJob> & _jobs, std::vector<BatchJobResult> & _results, const JobFinishedCallback & _onJobFinished)
+{
+    runBlocking(_jobs, _results, _onJobFinished);
+}
+
+#endif
+
+} // namespace PocketBook
@@ -0,0 +1,86 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include "bmpoptions.h"
+#include "bmpinstrumentation.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace PocketBook {
+
+class IoUring;
+
+// Conversion of a single file in the batch
+struct BatchJob
+{
+    std::string InputPath;
+    std::string OutputPath;
+    bool Compress = true; // false - decompress barch file into bmp
+};
+
+struct BatchJobResult
+{
+    bool Succeeded = false;
+    std::string ErrorMessage;
+
+    // Wall clock seconds of the job, with io_uring backend from the start of input read
+    // to completion of output write, including time the job waited for its turn to convert
+    double Seconds = 0.0;
+
+    // Statistics of compress/decompress, with io_uring backend they don't include file I/O
+    OperationStatistics Statistics;
+};
+
+enum class BatchIoBackend
+{
+    Blocking,
+    IoUring
+};
+
+struct BatchOptions
+{
+    // Codec.Statistics is ignored, each job result gets its own statistics
+    CodecOptions Codec;
+
+    // Maximum number of files being read, converted and written at once by io_uring backend
+    unsigned QueueDepth = 8;
+
+    // Use io_uring when it is built in and allowed by kernel, blocking file API otherwise.
+    // It pays off on cold storage, with hot page cache mapped inputs of blocking API are cheaper
+    bool PreferIoUring = false;
+};
+
+// BatchConverter runs conversions of many files on calling thread.
+// With io_uring backend inputs of next jobs are read and outputs of converted ones
+// are written asynchronously while the current file is encoded, memory is bounded
+// by QueueDepth files. Blocking backend converts files one by one through BmpProxy file API.
+// When the ring fails, requests in flight are cancelled and waited for, unfinished jobs
+// are converted by blocking backend which is used from then on.
+class BatchConverter
+{
+public:
+    using JobFinishedCallback = std::function<void(std::size_t _jobIndex, const BatchJobResult & _result)>;
+
+    explicit BatchConverter(const BatchOptions & _options = BatchOptions());
+    ~BatchConverter();
+
+    BatchIoBackend getBackend() const;
+
+    // Results are in order of _jobs, _onJobFinished is called as soon as each job completes
+    std::vector<BatchJobResult> run(const std::vector<BatchJob> & _jobs, const JobFinishedCallback & _onJobFinished = JobFinishedCallback());
+
+private:
+    void runBlocking(const std::vector<BatchJob> & _jobs, std::vector<BatchJobResult> & _results, const JobFinishedCallback & _onJobFinished);
+    BatchJobResult runBlockingJob(const BatchJob & _job) const;
+    void runIoUring(const std::vector<BatchJob> & _jobs, std::vector<BatchJobResult> & _results, const JobFinishedCallback & _onJobFinished);
+
+    BatchOptions m_options;
+    std::unique_ptr<IoUring> m_ring;
+};
+
+} // namespace PocketBook
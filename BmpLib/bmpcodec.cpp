@@ -0,0 +1,527 @@
+// Copyright PocketBook - Interview Task
+
+#include "bmpcodec.h"
+#include "bmpcodecformat.h"
+#include "bmpkernels.h"
+#include "bitwriter.h"
+#include "bitreader.h"
+#include "bmpdefs.h"
+#include "bmpexceptions.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace PocketBook::Codec {
+
+namespace {
+
+// Code '10' is stored LSB first, so sequence of black codes is 0b...0101
+static constexpr std::uint32_t BLACK_CODES_PATTERN = 0x55555555;
+static constexpr unsigned BLACK_CODE_BITS = 2;
+static constexpr unsigned LITERAL_CODE_BITS = 2;
+
+// Run length format keeps white '0' and literal '11', black becomes '100'
+// and '101' + colour bit (0 - white, 1 - black) + count codes a run of blocks
+static constexpr std::uint32_t RUN_BLACK_CODES_PATTERN = 0x49249249;
+static constexpr unsigned RUN_BLACK_CODE_BITS = 3;
+static constexpr std::uint32_t RUN_CODE = 0b101;
+static constexpr unsigned RUN_CODE_BITS = 3;
+
+// Run count minus MIN_RUN_BLOCKS is stored by groups of RUN_GROUP_BITS bits, the lowest group first,
+// each group is followed by a bit telling whether another one follows
+static constexpr std::size_t MIN_RUN_BLOCKS = 2;
+static constexpr unsigned RUN_GROUP_BITS = 6;
+static constexpr std::uint64_t RUN_GROUP_MASK = (1u << RUN_GROUP_BITS) - 1;
+static constexpr unsigned MAX_RUN_COUNT_BITS = 30;
+
+// Rows sampled by selectFormat(), evenly spread over the image
+static constexpr std::size_t FORMAT_SAMPLE_ROWS = 128;
+
+// Stands in for BitWriter when only the size of the output is needed
+class BitCounter
+{
+public:
+    void put(std::uint32_t, unsigned _count) { m_bits += _count; }
+    void putZeros(std::size_t _count) { m_bits += _count; }
+
+    std::uint64_t sizeInBits() const { return m_bits; }
+
+private:
+    std::uint64_t m_bits = 0;
+};
+
+// Blocks are made of SUB_BLOCKS 4 pixel blocks, so masks of classifyBlocks() are merged
+// into masks of wider blocks: wide block is set when all of its 4 pixel blocks are set
+template<unsigned SUB_BLOCKS>
+std::uint64_t mergeMask(std::uint64_t _mask);
+
+template<>
+inline std::uint64_t mergeMask<1>(std::uint64_t _mask)
+{
+    return _mask;
+}
+
+template<>
+inline std::uint64_t mergeMask<2>(std::uint64_t _mask)
+{
+    // Pair results are kept in even bits which are then packed together
+    std::uint64_t bits = _mask & (_mask >> 1) & 0x5555555555555555ull;
+    bits = (bits | (bits >> 1)) & 0x3333333333333333ull;
+    bits = (bits | (bits >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+    bits = (bits | (bits >> 4)) & 0x00FF00FF00FF00FFull;
+    bits = (bits | (bits >> 8)) & 0x0000FFFF0000FFFFull;
+    return (bits | (bits >> 16)) & 0x00000000FFFFFFFFull;
+}
+
+template<>
+inline std::uint64_t mergeMask<4>(std::uint64_t _mask)
+{
+    // Quad results are kept in every fourth bit which are then packed together
+    const std::uint64_t pairs = _mask & (_mask >> 1);
+    std::uint64_t bits = pairs & (pairs >> 2) & 0x1111111111111111ull;
+    bits = (bits | (bits >> 3)) & 0x0303030303030303ull;
+    bits = (bits | (bits >> 6)) & 0x000F000F000F000Full;
+    bits = (bits | (bits >> 12)) & 0x000000FF000000FFull;
+    return (bits | (bits >> 24)) & 0x000000000000FFFFull;
+}
+
+// Puts _count copies of the code repeated in _pattern
+template<typename Writer>
+void putCodes(std::uint32_t _pattern, unsigned _codeBits, std::size_t _count, Writer & _writer)
+{
+    const std::size_t codesPerWord = 32 / _codeBits;
+    while(_count > 0)
+    {
+        const auto chunk = static_cast<unsigned>(std::min(_count, codesPerWord));
+        const unsigned numBits = chunk * _codeBits;
+        const std::uint32_t mask = numBits == 32 ? ~std::uint32_t(0) : (std::uint32_t(1) << numBits) - 1;
+        _writer.put(_pattern & mask, numBits);
+        _count -= chunk;
+    }
+}
+
+std::size_t getRunBits(std::size_t _count)
+{
+    std::size_t groups = 1;
+    for(std::size_t value = (_count - MIN_RUN_BLOCKS) >> RUN_GROUP_BITS; value != 0; value >>= RUN_GROUP_BITS)
+        ++groups;
+    return RUN_CODE_BITS + 1 + groups * (RUN_GROUP_BITS + 1);
+}
+
+template<typename Writer>
+void putRun(bool _black, std::size_t _count, Writer & _writer)
+{
+    _writer.put(RUN_CODE | (static_cast<std::uint32_t>(_black) << RUN_CODE_BITS), RUN_CODE_BITS + 1);
+
+    std::size_t value = _count - MIN_RUN_BLOCKS;
+    do
+    {
+        const auto group = static_cast<std::uint32_t>(value & RUN_GROUP_MASK);
+        value >>= RUN_GROUP_BITS;
+        _writer.put(group | (static_cast<std::uint32_t>(value != 0) << RUN_GROUP_BITS), RUN_GROUP_BITS + 1);
+    }
+    while(value != 0);
+}
+
+// Puts _count consecutive white or black blocks, run code is used only when it is shorter
+template<typename Writer>
+void putRepeated(bool _black, std::size_t _count, bool _runLength, Writer & _writer)
+{
+    if(!_runLength)
+    {
+        if(_black)
+            putCodes(BLACK_CODES_PATTERN, BLACK_CODE_BITS, _count, _writer);
+        else
+            _writer.putZeros(_count);
+        return;
+    }
+
+    const std::size_t plainBits = _black ? _count * RUN_BLACK_CODE_BITS : _count;
+    if(_count >= MIN_RUN_BLOCKS && getRunBits(_count) < plainBits)
+        putRun(_black, _count, _writer);
+    else if(_black)
+        putCodes(RUN_BLACK_CODES_PATTERN, RUN_BLACK_CODE_BITS, _count, _writer);
+    else
+        _writer.putZeros(_count);
+}
+
+template<unsigned SUB_BLOCKS, typename Writer>
+void putLiteral(const std::uint8_t * _block, Writer & _writer)
+{
+    _writer.put(0b11, LITERAL_CODE_BITS);
+    for(unsigned subBlock = 0; subBlock < SUB_BLOCKS; ++subBlock)
+    {
+        std::uint32_t blockValue;
+        memcpy(&blockValue, _block + subBlock * sizeof(blockValue), sizeof(blockValue));
+        _writer.put(blockValue, 32);
+    }
+}
+
+void addBlocks(std::size_t _count, std::uint64_t _whiteMask, std::uint64_t _blackMask, BlockCounts & _counts)
+{
+    const std::size_t white = std::bitset<64>(_whiteMask).count();
+    const std::size_t black = std::bitset<64>(_blackMask).count();
+    _counts.White += white;
+    _counts.Black += black;
+    _counts.Literal += _count - white - black;
+}
+
+// Calls _onChunk(chunk, count, whiteMask, blackMask) for consecutive chunks of _count blocks
+// of SUB_BLOCKS 4 pixel blocks each, a chunk fits in a single classifyBlocks() call
+template<unsigned SUB_BLOCKS, typename OnChunk>
+void classifyChunks(const std::uint8_t * _blocks, std::size_t _count, std::uint32_t _whiteBlock, std::uint32_t _blackBlock, OnChunk && _onChunk)
+{
+    static constexpr std::size_t BLOCK_SIZE = SUB_BLOCKS * sizeof(std::uint32_t);
+    static constexpr std::size_t BLOCKS_PER_CHUNK = Kernels::CLASSIFY_BLOCKS_MAX / SUB_BLOCKS;
+
+    for(std::size_t chunkStart = 0; chunkStart < _count; chunkStart += BLOCKS_PER_CHUNK)
+    {
+        const std::size_t count = std::min(_count - chunkStart, BLOCKS_PER_CHUNK);
+        const std::uint8_t * chunk = _blocks + chunkStart * BLOCK_SIZE;
+
+        std::uint64_t whiteMask;
+        std::uint64_t blackMask;
+        Kernels::classifyBlocks(chunk, count * SUB_BLOCKS, _whiteBlock, _blackBlock, whiteMask, blackMask);
+        _onChunk(chunk, count, mergeMask<SUB_BLOCKS>(whiteMask), mergeMask<SUB_BLOCKS>(blackMask));
+    }
+}
+
+template<unsigned SUB_BLOCKS, typename Writer>
+void encodeBlocks(
+        const std::uint8_t * _blocks
+    ,   std::size_t _count
+    ,   const BmpCodecFormat & _format
+    ,   Writer & _writer
+    ,   BlockCounts * _counts
+    )
+{
+    static constexpr std::size_t BLOCK_SIZE = SUB_BLOCKS * sizeof(std::uint32_t);
+
+    // Runs of white and black blocks are emitted in bulk, a run may continue into the next chunk
+    const bool runLength = _format.hasRunLength();
+    std::size_t run = 0;
+    bool runBlack = false;
+    auto extendRun = [&](bool _black, std::size_t _runCount)
+    {
+        if(run > 0 && runBlack != _black)
+            putRepeated(runBlack, std::exchange(run, 0), runLength, _writer);
+        runBlack = _black;
+        run += _runCount;
+    };
+
+    classifyChunks<SUB_BLOCKS>(_blocks, _count, _format.getWhiteBlock(), _format.getBlackBlock(), [&](const std::uint8_t * _chunk, std::size_t _chunkCount, std::uint64_t _whiteMask, std::uint64_t _blackMask)
+    {
+        if(_counts)
+            addBlocks(_chunkCount, _whiteMask, _blackMask, *_counts);
+
+        // Only literals are handled one by one
+        std::size_t blockIndex = 0;
+        while(blockIndex < _chunkCount)
+        {
+            const std::uint64_t white = _whiteMask >> blockIndex;
+            const std::uint64_t black = _blackMask >> blockIndex;
+            if(white & 1)
+            {
+                const std::size_t runCount = Kernels::countTrailingOnes(white);
+                extendRun(false, runCount);
+                blockIndex += runCount;
+            }
+            else if(black & 1)
+            {
+                const std::size_t runCount = Kernels::countTrailingOnes(black);
+                extendRun(true, runCount);
+                blockIndex += runCount;
+            }
+            else
+            {
+                if(run > 0)
+                    putRepeated(runBlack, std::exchange(run, 0), runLength, _writer);
+                putLiteral<SUB_BLOCKS>(_chunk + blockIndex * BLOCK_SIZE, _writer);
+                ++blockIndex;
+            }
+        }
+    });
+
+    if(run > 0)
+        putRepeated(runBlack, run, runLength, _writer);
+}
+
+template<unsigned SUB_BLOCKS>
+void fillBlock(std::uint8_t * _dest, std::uint32_t _block)
+{
+    for(unsigned subBlock = 0; subBlock < SUB_BLOCKS; ++subBlock)
+        memcpy(_dest + subBlock * sizeof(_block), &_block, sizeof(_block));
+}
+
+// Reads count of the run code following its colour bit, the run must fit into _maxCount blocks
+std::size_t readRunCount(BitReader & _reader, std::size_t _maxCount)
+{
+    std::size_t value = 0;
+    for(unsigned shift = 0; ; shift += RUN_GROUP_BITS)
+    {
+        if(shift >= MAX_RUN_COUNT_BITS)
+            throw InvalidPixelDataError("Run of blocks is too long");
+
+        const std::uint64_t bits = _reader.peek();
+        _reader.skip(RUN_GROUP_BITS + 1);
+        value |= static_cast<std::size_t>(bits & RUN_GROUP_MASK) << shift;
+        if(((bits >> RUN_GROUP_BITS) & 1) == 0)
+            break;
+    }
+
+    if(value > _maxCount || _maxCount - value < MIN_RUN_BLOCKS)
+        throw InvalidPixelDataError("Run of blocks exceeds the row");
+    return value + MIN_RUN_BLOCKS;
+}
+
+template<unsigned SUB_BLOCKS, bool RUN_LENGTH>
+std::uint8_t * decodeBlocks(BitReader & _reader, std::uint8_t * _dest, std::size_t _count, const BmpCodecFormat & _format)
+{
+    static constexpr std::size_t BLOCK_SIZE = SUB_BLOCKS * sizeof(std::uint32_t);
+
+    const std::uint32_t whiteBlock = _format.getWhiteBlock();
+    const std::uint32_t blackBlock = _format.getBlackBlock();
+    for(std::size_t blockIndex = 0; blockIndex < _count; ++blockIndex)
+    {
+        const std::uint64_t bits = _reader.peek();
+        if((bits & 0b01) == 0) // '0'
+        {
+            fillBlock<SUB_BLOCKS>(_dest, whiteBlock);
+            _reader.skip(1);
+        }
+        else if((bits & 0b10) != 0) // '11' + pixels of the block
+        {
+            // The first 4 pixels are already peeked, each next 4 pixels need another peek
+            auto block = static_cast<std::uint32_t>(bits >> LITERAL_CODE_BITS);
+            memcpy(_dest, &block, sizeof(block));
+            _reader.skip(LITERAL_CODE_BITS + sizeof(block) * 8);
+            for(unsigned subBlock = 1; subBlock < SUB_BLOCKS; ++subBlock)
+            {
+                block = static_cast<std::uint32_t>(_reader.peek());
+                memcpy(_dest + subBlock * sizeof(block), &block, sizeof(block));
+                _reader.skip(sizeof(block) * 8);
+            }
+        }
+        else if(!RUN_LENGTH || (bits & 0b100) == 0) // '10', or '100' of run length format
+        {
+            fillBlock<SUB_BLOCKS>(_dest, blackBlock);
+            _reader.skip(RUN_LENGTH ? RUN_BLACK_CODE_BITS : BLACK_CODE_BITS);
+        }
+        else // '101' + colour + count, the whole run is filled at once
+        {
+            const bool black = (bits >> RUN_CODE_BITS) & 1;
+            _reader.skip(RUN_CODE_BITS + 1);
+            const std::size_t runCount = readRunCount(_reader, _count - blockIndex);
+            memset(_dest, black ? _format.getBlackPixel() : _format.getWhitePixel(), runCount * BLOCK_SIZE);
+            _dest += runCount * BLOCK_SIZE;
+            blockIndex += runCount - 1;
+            continue;
+        }
+
+        _dest += BLOCK_SIZE;
+    }
+    return _dest;
+}
+
+template<unsigned SUB_BLOCKS, bool RUN_LENGTH>
+void skipBlocks(BitReader & _reader, std::size_t _count)
+{
+    for(std::size_t blockIndex = 0; blockIndex < _count; ++blockIndex)
+    {
+        const std::uint64_t bits = _reader.peek();
+        if((bits & 0b01) == 0) // '0'
+        {
+            _reader.skip(1);
+        }
+        else if((bits & 0b10) != 0) // '11' + pixels of the block
+        {
+            _reader.skip(LITERAL_CODE_BITS + SUB_BLOCKS * sizeof(std::uint32_t) * 8);
+        }
+        else if(!RUN_LENGTH || (bits & 0b100) == 0) // '10', or '100' of run length format
+        {
+            _reader.skip(RUN_LENGTH ? RUN_BLACK_CODE_BITS : BLACK_CODE_BITS);
+        }
+        else // '101' + colour + count
+        {
+            _reader.skip(RUN_CODE_BITS + 1);
+            blockIndex += readRunCount(_reader, _count - blockIndex) - 1;
+        }
+    }
+}
+
+// Row is split into wide blocks and the tail of 4 pixel blocks that don't fill a wide one
+template<unsigned SUB_BLOCKS, typename Writer>
+void encodeRowBlocks(const std::uint8_t * _row, std::size_t _numBlocks, const BmpCodecFormat & _format, Writer & _writer, BlockCounts * _counts)
+{
+    const std::size_t wideBlocks = _numBlocks / SUB_BLOCKS;
+    encodeBlocks<SUB_BLOCKS>(_row, wideBlocks, _format, _writer, _counts);
+    encodeBlocks<1>(_row + wideBlocks * SUB_BLOCKS * sizeof(std::uint32_t), _numBlocks % SUB_BLOCKS, _format, _writer, _counts);
+}
+
+template<typename Writer>
+void encodeRowTo(const std::uint8_t * _row, std::size_t _numBlocks, const BmpCodecFormat & _format, Writer & _writer, BlockCounts * _counts)
+{
+    switch(_format.getBlockWidth())
+    {
+    case 8:
+        return encodeRowBlocks<2>(_row, _numBlocks, _format, _writer, _counts);
+    case 16:
+        return encodeRowBlocks<4>(_row, _numBlocks, _format, _writer, _counts);
+    default:
+        return encodeRowBlocks<1>(_row, _numBlocks, _format, _writer, _counts);
+    }
+}
+
+template<unsigned SUB_BLOCKS>
+void countRowBlocks(const std::uint8_t * _row, std::size_t _numBlocks, const BmpCodecFormat & _format, BlockCounts & _counts)
+{
+    auto onChunk = [&](const std::uint8_t *, std::size_t _chunkCount, std::uint64_t _whiteMask, std::uint64_t _blackMask)
+    {
+        addBlocks(_chunkCount, _whiteMask, _blackMask, _counts);
+    };
+
+    const std::size_t wideBlocks = _numBlocks / SUB_BLOCKS;
+    classifyChunks<SUB_BLOCKS>(_row, wideBlocks, _format.getWhiteBlock(), _format.getBlackBlock(), onChunk);
+    classifyChunks<1>(_row + wideBlocks * SUB_BLOCKS * sizeof(std::uint32_t), _numBlocks % SUB_BLOCKS, _format.getWhiteBlock(), _format.getBlackBlock(), onChunk);
+}
+
+template<unsigned SUB_BLOCKS, bool RUN_LENGTH>
+void decodeRowBlocks(BitReader & _reader, std::uint8_t * _row, std::size_t _numBlocks, const BmpCodecFormat & _format)
+{
+    std::uint8_t * tail = decodeBlocks<SUB_BLOCKS, RUN_LENGTH>(_reader, _row, _numBlocks / SUB_BLOCKS, _format);
+    decodeBlocks<1, RUN_LENGTH>(_reader, tail, _numBlocks % SUB_BLOCKS, _format);
+}
+
+template<unsigned SUB_BLOCKS>
+void decodeRowBlocks(BitReader & _reader, std::uint8_t * _row, std::size_t _numBlocks, const BmpCodecFormat & _format)
+{
+    if(_format.hasRunLength())
+        decodeRowBlocks<SUB_BLOCKS, true>(_reader, _row, _numBlocks, _format);
+    else
+        decodeRowBlocks<SUB_BLOCKS, false>(_reader, _row, _numBlocks, _format);
+}
+
+template<unsigned SUB_BLOCKS, bool RUN_LENGTH>
+void skipRowBlocks(BitReader & _reader, std::size_t _numBlocks)
+{
+    skipBlocks<SUB_BLOCKS, RUN_LENGTH>(_reader, _numBlocks / SUB_BLOCKS);
+    skipBlocks<1, RUN_LENGTH>(_reader, _numBlocks % SUB_BLOCKS);
+}
+
+template<unsigned SUB_BLOCKS>
+void skipRowBlocks(BitReader & _reader, std::size_t _numBlocks, const BmpCodecFormat & _format)
+{
+    if(_format.hasRunLength())
+        skipRowBlocks<SUB_BLOCKS, true>(_reader, _numBlocks);
+    else
+        skipRowBlocks<SUB_BLOCKS, false>(_reader, _numBlocks);
+}
+
+} // namespace
+
+BlockCounts & BlockCounts::operator += (const BlockCounts & _other)
+{
+    White += _other.White;
+    Black += _other.Black;
+    Literal += _other.Literal;
+    return *this;
+}
+
+void encodeRow(
+        const std::uint8_t * _row
+    ,   std::size_t _numBlocks
+    ,   const BmpCodecFormat & _format
+    ,   BitWriter & _writer
+    ,   BlockCounts * _counts
+    )
+{
+    encodeRowTo(_row, _numBlocks, _format, _writer, _counts);
+}
+
+void countBlocks(const std::uint8_t * _row, std::size_t _numBlocks, const BmpCodecFormat & _format, BlockCounts & _counts)
+{
+    switch(_format.getBlockWidth())
+    {
+    case 8:
+        return countRowBlocks<2>(_row, _numBlocks, _format, _counts);
+    case 16:
+        return countRowBlocks<4>(_row, _numBlocks, _format, _counts);
+    default:
+        return countRowBlocks<1>(_row, _numBlocks, _format, _counts);
+    }
+}
+
+void decodeRow(BitReader & _reader, std::uint8_t * _row, std::size_t _numBlocks, const BmpCodecFormat & _format)
+{
+    switch(_format.getBlockWidth())
+    {
+    case 8:
+        return decodeRowBlocks<2>(_reader, _row, _numBlocks, _format);
+    case 16:
+        return decodeRowBlocks<4>(_reader, _row, _numBlocks, _format);
+    default:
+        return decodeRowBlocks<1>(_reader, _row, _numBlocks, _format);
+    }
+}
+
+void skipRow(BitReader & _reader, std::size_t _numBlocks, const BmpCodecFormat & _format)
+{
+    switch(_format.getBlockWidth())
+    {
+    case 8:
+        return skipRowBlocks<2>(_reader, _numBlocks, _format);
+    case 16:
+        return skipRowBlocks<4>(_reader, _numBlocks, _format);
+    default:
+        return skipRowBlocks<1>(_reader, _numBlocks, _format);
+    }
+}
+
+BmpCodecFormat selectFormat(const RawImageData & _raw, const std::vector<BmpCodecFormat> & _candidates)
+{
+    if(_candidates.empty())
+        throw std::invalid_argument("No codec format to select from");
+    if(_candidates.size() == 1)
+        return _candidates.front();
+
+    const std::size_t height = _raw.getActualHeight();
+    const std::size_t rowSize = _raw.getActualWidth();
+    const std::size_t numBlocks = rowSize / sizeof(std::uint32_t);
+    const std::size_t step = std::max<std::size_t>(height / FORMAT_SAMPLE_ROWS, 1);
+
+    // White rows are stored only in the index, so they cost the same for every candidate
+    std::vector<BitCounter> counters(_candidates.size());
+    for(std::size_t rowIndex = step / 2; rowIndex < height; rowIndex += step)
+    {
+        const std::uint8_t * row = _raw.Data + rowIndex * rowSize;
+        if(Kernels::isWhiteRow(row, _raw.Width, _raw.getPadding(), _candidates.front().getWhitePixel()))
+            continue;
+
+        for(std::size_t candidate = 0; candidate < _candidates.size(); ++candidate)
+            encodeRowTo(row, numBlocks, _candidates[candidate], counters[candidate], nullptr);
+    }
+
+    // Sampled rows stand for step rows each, format chunk of the candidate is counted too
+    auto getSizeInBits = [&](std::size_t _candidate)
+    {
+        return counters[_candidate].sizeInBits() * step + _candidates[_candidate].serialize().size() * 8;
+    };
+
+    std::size_t best = 0;
+    std::uint64_t bestSize = getSizeInBits(0);
+    for(std::size_t candidate = 1; candidate < _candidates.size(); ++candidate)
+    {
+        const std::uint64_t size = getSizeInBits(candidate);
+        if(size < bestSize)
+        {
+            best = candidate;
+            bestSize = size;
+        }
+    }
+    return _candidates[best];
+}
+
+} // namespace PocketBook::Codec
@@ -0,0 +1,60 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace PocketBook {
+
+class BitWriter;
+class BitReader;
+class BmpCodecFormat;
+struct RawImageData;
+
+namespace Codec {
+
+// Numbers of coded blocks of each kind
+struct BlockCounts
+{
+    std::uint64_t White = 0;
+    std::uint64_t Black = 0;
+    std::uint64_t Literal = 0;
+
+    BlockCounts & operator += (const BlockCounts & _other);
+};
+
+// Encodes single non-white row of _numBlocks 4 pixel blocks. Pixels are coded by blocks of _format
+// block width, the tail of the row shorter than a block is coded by 4 pixels. White and black are
+// pixels of _format:
+// * each block of white pixels -> 0
+// * each block of black pixels -> 10
+// * other block -> 11 + pix0 + pix1 + ... + pixN
+// Formats with run length coding code black block by 100 and may replace consecutive white
+// or black blocks by 101 + colour bit (0 - white, 1 - black) + count, whichever is shorter.
+// Runs don't cross rows. Blocks of the row are added to _counts when it is given.
+void encodeRow(
+        const std::uint8_t * _row
+    ,   std::size_t _numBlocks
+    ,   const BmpCodecFormat & _format
+    ,   BitWriter & _writer
+    ,   BlockCounts * _counts = nullptr
+    );
+
+// Adds blocks of the row to _counts without encoding it
+void countBlocks(const std::uint8_t * _row, std::size_t _numBlocks, const BmpCodecFormat & _format, BlockCounts & _counts);
+
+// Decodes single non-white row of _numBlocks 4 pixel blocks encoded by encodeRow() with the same _format
+void decodeRow(BitReader & _reader, std::uint8_t * _row, std::size_t _numBlocks, const BmpCodecFormat & _format);
+
+// Moves _reader past single non-white row of _numBlocks 4 pixel blocks without decoding it
+void skipRow(BitReader & _reader, std::size_t _numBlocks, const BmpCodecFormat & _format);
+
+// Returns one of _candidates giving the smallest output for sampled rows of _raw including
+// the format chunk. Candidates must share white pixel, a later candidate wins only when it is
+// strictly smaller than all before it.
+BmpCodecFormat selectFormat(const RawImageData & _raw, const std::vector<BmpCodecFormat> & _candidates);
+
+} // namespace Codec
+} // namespace PocketBook
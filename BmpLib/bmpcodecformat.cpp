@@ -0,0 +1,164 @@
+// Copyright PocketBook - Interview Task
+
+#include "bmpcodecformat.h"
+#include "bmpexceptions.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace PocketBook {
+
+namespace {
+
+#pragma pack(push, 1)
+struct FormatChunkPayload
+{
+    std::uint8_t WhitePixel;
+    std::uint8_t BlackPixel;
+    std::uint8_t BlockWidth; // Zero in files written before block width was stored, means 4
+    std::uint8_t Flags;      // BmpCodecFormat::FLAG_*
+};
+#pragma pack(pop)
+
+// Size of BGRA entry of bmp colour table
+static constexpr std::size_t COLOR_ENTRY_SIZE = 4;
+
+static constexpr std::uint32_t REPEAT_BYTE = 0x01010101;
+
+// Luma of BGRA entry scaled by 1000
+std::uint32_t getBrightness(const std::uint8_t * _color)
+{
+    return _color[2] * 299u + _color[1] * 587u + _color[0] * 114u;
+}
+
+} // namespace
+
+BmpCodecFormat::BmpCodecFormat(std::uint8_t _whitePixel, std::uint8_t _blackPixel, unsigned _blockWidth, bool _runLength)
+    : m_whitePixel(_whitePixel), m_blackPixel(_blackPixel), m_blockWidth(_blockWidth), m_runLength(_runLength)
+{
+    if(!isValidBlockWidth(_blockWidth))
+        throw std::invalid_argument(std::string("Unsupported block width: ") + std::to_string(_blockWidth));
+}
+
+std::uint8_t BmpCodecFormat::getWhitePixel() const
+{
+    return m_whitePixel;
+}
+
+std::uint8_t BmpCodecFormat::getBlackPixel() const
+{
+    return m_blackPixel;
+}
+
+std::uint32_t BmpCodecFormat::getWhiteBlock() const
+{
+    return m_whitePixel * REPEAT_BYTE;
+}
+
+std::uint32_t BmpCodecFormat::getBlackBlock() const
+{
+    return m_blackPixel * REPEAT_BYTE;
+}
+
+unsigned BmpCodecFormat::getBlockWidth() const
+{
+    return m_blockWidth;
+}
+
+BmpCodecFormat BmpCodecFormat::withBlockWidth(unsigned _blockWidth) const
+{
+    return BmpCodecFormat(m_whitePixel, m_blackPixel, _blockWidth, m_runLength);
+}
+
+bool BmpCodecFormat::isValidBlockWidth(unsigned _blockWidth)
+{
+    return _blockWidth == 4 || _blockWidth == 8 || _blockWidth == 16;
+}
+
+bool BmpCodecFormat::hasRunLength() const
+{
+    return m_runLength;
+}
+
+BmpCodecFormat BmpCodecFormat::withRunLength(bool _runLength) const
+{
+    return BmpCodecFormat(m_whitePixel, m_blackPixel, m_blockWidth, _runLength);
+}
+
+bool BmpCodecFormat::isDefault() const
+{
+    return m_whitePixel == WHITE_PIXEL && m_blackPixel == BLACK_PIXEL && m_blockWidth == DEFAULT_BLOCK_WIDTH && !m_runLength;
+}
+
+std::vector<std::uint8_t> BmpCodecFormat::serialize() const
+{
+    if(isDefault())
+        return {};
+
+    BarchChunkHeader chunkHeader;
+    chunkHeader.Tag = FORMAT_TAG;
+    chunkHeader.Size = sizeof(FormatChunkPayload);
+
+    FormatChunkPayload payload{};
+    payload.WhitePixel = m_whitePixel;
+    payload.BlackPixel = m_blackPixel;
+    payload.BlockWidth = static_cast<std::uint8_t>(m_blockWidth);
+    payload.Flags = m_runLength ? FLAG_RUN_LENGTH : 0;
+
+    std::vector<std::uint8_t> chunk(sizeof(chunkHeader) + sizeof(payload));
+    memcpy(chunk.data(), &chunkHeader, sizeof(chunkHeader));
+    memcpy(chunk.data() + sizeof(chunkHeader), &payload, sizeof(payload));
+    return chunk;
+}
+
+BmpCodecFormat BmpCodecFormat::createFromChunk(const std::uint8_t * _payload, std::size_t _payloadSize)
+{
+    FormatChunkPayload payload;
+    if(_payloadSize < sizeof(payload))
+        throw InvalidPixelDataError("Codec format is truncated");
+
+    memcpy(&payload, _payload, sizeof(payload));
+    if(payload.WhitePixel == payload.BlackPixel)
+        throw InvalidPixelDataError(std::string("Invalid codec format, white and black pixels are ") + std::to_string(payload.WhitePixel));
+
+    const unsigned blockWidth = payload.BlockWidth ? payload.BlockWidth : DEFAULT_BLOCK_WIDTH;
+    if(!isValidBlockWidth(blockWidth))
+        throw InvalidPixelDataError(std::string("Unsupported block width: ") + std::to_string(blockWidth));
+
+    // Unknown flags change meaning of the codes, so such files can't be decoded
+    if(payload.Flags & ~FLAG_RUN_LENGTH)
+        throw InvalidPixelDataError(std::string("Unsupported codec format flags: ") + std::to_string(payload.Flags));
+
+    return BmpCodecFormat(payload.WhitePixel, payload.BlackPixel, blockWidth, (payload.Flags & FLAG_RUN_LENGTH) != 0);
+}
+
+BmpCodecFormat BmpCodecFormat::createFromColorTable(const std::uint8_t * _colorTable, std::size_t _colorCount)
+{
+    if(!_colorTable || _colorCount < 2)
+        return BmpCodecFormat();
+
+    auto getColor = [&](std::size_t _index)
+    {
+        return _colorTable + _index * COLOR_ENTRY_SIZE;
+    };
+
+    // Start from default indices when palette has them, so other indices must be strictly better
+    std::size_t white = WHITE_PIXEL < _colorCount ? WHITE_PIXEL : 0;
+    std::size_t black = BLACK_PIXEL < _colorCount ? BLACK_PIXEL : 0;
+    for(std::size_t index = 0; index < _colorCount; ++index)
+    {
+        const std::uint32_t brightness = getBrightness(getColor(index));
+        if(brightness > getBrightness(getColor(white)))
+            white = index;
+        if(brightness < getBrightness(getColor(black)))
+            black = index;
+    }
+
+    // Single color palette has nothing to tell apart
+    if(white == black)
+        return BmpCodecFormat();
+
+    return BmpCodecFormat(static_cast<std::uint8_t>(white), static_cast<std::uint8_t>(black));
+}
+
+} // namespace PocketBook
@@ -0,0 +1,69 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include "bmpdefs.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace PocketBook {
+
+// BmpCodecFormat describes how blocks of compressed pixel data map to pixels.
+// White and black are palette indices coded by short codes, they are resolved
+// from the colour table when bmp is compressed. Block width is the number of
+// pixels coded by a single code, it is chosen by sampling the image as well as
+// run length coding of consecutive white and black blocks.
+// Files of the default format have no format chunk, otherwise it is stored
+// in barch file as FORMAT_TAG chunk after the band table:
+// WhitePixel (1 byte), BlackPixel (1 byte), BlockWidth (1 byte), Flags (1 byte)
+class BmpCodecFormat
+{
+public:
+    static constexpr unsigned DEFAULT_BLOCK_WIDTH = 4;
+    static constexpr unsigned MAX_BLOCK_WIDTH = 16;
+
+    // Bits of Flags, readers reject files with unknown flags
+    static constexpr std::uint8_t FLAG_RUN_LENGTH = 0x01;
+
+    BmpCodecFormat() = default;
+    BmpCodecFormat(std::uint8_t _whitePixel, std::uint8_t _blackPixel, unsigned _blockWidth = DEFAULT_BLOCK_WIDTH, bool _runLength = false);
+
+    std::uint8_t getWhitePixel() const;
+    std::uint8_t getBlackPixel() const;
+
+    // Pixel repeated in each byte of 4 pixel block
+    std::uint32_t getWhiteBlock() const;
+    std::uint32_t getBlackBlock() const;
+
+    // 4, 8 or 16 pixels
+    unsigned getBlockWidth() const;
+    BmpCodecFormat withBlockWidth(unsigned _blockWidth) const;
+
+    static bool isValidBlockWidth(unsigned _blockWidth);
+
+    // Runs of white and black blocks inside non-white rows are coded by count
+    bool hasRunLength() const;
+    BmpCodecFormat withRunLength(bool _runLength) const;
+
+    bool isDefault() const;
+
+    // Returns format serialized as barch chunk including chunk header, empty for default format
+    std::vector<std::uint8_t> serialize() const;
+
+    static BmpCodecFormat createFromChunk(const std::uint8_t * _payload, std::size_t _payloadSize);
+
+    // _colorTable is an array of _colorCount BGRA entries. Exact white and black are preferred,
+    // otherwise the brightest and the darkest colors are used. Default indices win ties,
+    // so standard grayscale palettes keep the default format.
+    static BmpCodecFormat createFromColorTable(const std::uint8_t * _colorTable, std::size_t _colorCount);
+
+private:
+    std::uint8_t m_whitePixel = WHITE_PIXEL;
+    std::uint8_t m_blackPixel = BLACK_PIXEL;
+    unsigned m_blockWidth = DEFAULT_BLOCK_WIDTH;
+    bool m_runLength = false;
+};
+
+} // namespace PocketBook
@@ -3,6 +3,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 
 namespace PocketBook {
 
@@ -31,6 +32,13 @@ struct BmpInfoHeader
     std::uint32_t ColorsUsed;
     std::uint32_t NumImportantColors;
 };
+
+// Barch chunks are stored between Index Data and compressed Pixel Data
+struct BarchChunkHeader
+{
+    std::uint32_t Tag;
+    std::uint32_t Size; // payload size in bytes, excluding the header
+};
 #pragma pack(pop)
 
 struct RawImageData
@@ -61,6 +69,15 @@ struct RawImageData
     const unsigned char * Data; // Pointer to image data. data[j * width + i] is color of pixel in row j and column i.
 };
 
+// Rectangle of image pixels, rows are counted in file order (bottom-up for BMP)
+struct ImageRegion
+{
+    std::size_t X;
+    std::size_t Y;
+    std::size_t Width;
+    std::size_t Height;
+};
+
 // Constants
 static constexpr std::size_t    BPM_HEADER_OFFSET        = 0x00;
 static constexpr std::size_t    INFO_HEADER_OFFSET       = sizeof(PocketBook::BmpHeader);
@@ -70,5 +87,7 @@ static constexpr std::uint8_t   WHITE_PIXEL              = 0xFF;
 static constexpr std::uint8_t   BLACK_PIXEL              = 0x00;
 static constexpr std::uint32_t  WHITE_4PIXELS            = 0xFFFFFFFF;
 static constexpr std::uint32_t  BLACK_4PIXELS            = 0x00000000;
+static constexpr std::uint32_t  BAND_TABLE_TAG           = 0x444E4142; // 'BAND'
+static constexpr std::uint32_t  FORMAT_TAG               = 0x544D5246; // 'FRMT'
 
 } // namespace PocketBook
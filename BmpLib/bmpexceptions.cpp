@@ -48,4 +48,9 @@ InvalidPixelDataError::InvalidPixelDataError(const std::string &_message)
 {
 }
 
+OperationCancelledError::OperationCancelledError()
+    : std::runtime_error("Operation cancelled")
+{
+}
+
 } // namespace PocketBook
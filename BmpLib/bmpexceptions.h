@@ -56,4 +56,12 @@ public:
     InvalidPixelDataError(const std::string & _message = std::string());
 };
 
+// Thrown inside compress/decompress when CodecOptions cancellation token or deadline stops it
+class OperationCancelledError
+    : public std::runtime_error
+{
+public:
+    OperationCancelledError();
+};
+
 } // namespace PocketBook
@@ -0,0 +1,48 @@
+// Copyright PocketBook - Interview Task
+
+#include "bmpinstrumentation.h"
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+namespace PocketBook {
+
+PageFaultCounts getProcessPageFaults()
+{
+    PageFaultCounts faults;
+
+#ifdef __unix__
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        faults.Minor = static_cast<std::uint64_t>(usage.ru_minflt);
+        faults.Major = static_cast<std::uint64_t>(usage.ru_majflt);
+    }
+#endif
+
+    return faults;
+}
+
+PageFaultCounts operator - (const PageFaultCounts & _lhs, const PageFaultCounts & _rhs)
+{
+    PageFaultCounts faults;
+    faults.Minor = _lhs.Minor - _rhs.Minor;
+    faults.Major = _lhs.Major - _rhs.Major;
+    return faults;
+}
+
+double OperationStatistics::getCompressionRatio() const
+{
+    const std::uint64_t bmpBytes = Compress ? BytesRead : BytesWritten;
+    const std::uint64_t barchBytes = Compress ? BytesWritten : BytesRead;
+    return bmpBytes && barchBytes ? static_cast<double>(bmpBytes) / barchBytes : 0.0;
+}
+
+double OperationStatistics::getThroughput() const
+{
+    const std::uint64_t bmpBytes = Compress ? BytesRead : BytesWritten;
+    return TotalSeconds > 0.0 ? bmpBytes / 1e6 / TotalSeconds : 0.0;
+}
+
+} // namespace PocketBook
@@ -0,0 +1,64 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include "bmpoptions.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace PocketBook {
+
+struct PageFaultCounts
+{
+    std::uint64_t Minor = 0; // Served from page cache or zero page
+    std::uint64_t Major = 0; // Required reading from storage
+};
+
+// Page faults of the whole process so far, zeros where not supported
+PageFaultCounts getProcessPageFaults();
+
+PageFaultCounts operator - (const PageFaultCounts & _lhs, const PageFaultCounts & _rhs);
+
+// How BmpProxy input was read and what it cost in page faults.
+// Faults are counted for the whole process, so concurrent work of other threads is included.
+struct ReadStatistics
+{
+    ReadStrategy Strategy = ReadStrategy::Map; // Actual strategy, never Auto
+    PageFaultCounts OpenFaults;                // Taken while the file was opened and validated
+    PageFaultCounts LastOperationFaults;       // Taken by the last compress/decompress
+};
+
+// What single compress/decompress did, filled when CodecOptions::Statistics is set.
+// Times are wall clock seconds. Codec and Write don't overlap, the rest of Total
+// is spent on headers, tables and patching of the output.
+struct OperationStatistics
+{
+    bool Compress = true;
+
+    double TotalSeconds = 0.0;
+    double CodecSeconds = 0.0;          // Encoding or decoding rows
+    double WriteSeconds = 0.0;          // Inside output sink
+
+    std::uint64_t BytesRead = 0;        // Input file
+    std::uint64_t BytesWritten = 0;     // Output file
+
+    unsigned BlockWidth = 4;            // Pixels per block of the codec format
+    bool RunLength = false;             // Codec format codes runs of white and black blocks by count
+
+    std::uint64_t Rows = 0;
+    std::uint64_t WhiteRows = 0;        // Stored only as bits of row index
+    std::uint64_t WhiteBlocks = 0;      // Coded blocks of non-white rows, row tails are 4 pixel blocks
+    std::uint64_t BlackBlocks = 0;
+    std::uint64_t LiteralBlocks = 0;
+
+    std::size_t PeakBufferBytes = 0;    // Working buffers of the codec, input mapping isn't included
+
+    // Size of bmp divided by size of barch, 0 when either is unknown
+    double getCompressionRatio() const;
+
+    // MB/s of bmp data over TotalSeconds
+    double getThroughput() const;
+};
+
+} // namespace PocketBook
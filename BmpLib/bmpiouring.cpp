@@ -0,0 +1,253 @@
+// Copyright PocketBook - Interview Task
+
+#include "bmpiouring.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+#ifdef POCKETBOOK_HAS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace PocketBook {
+
+#ifdef POCKETBOOK_HAS_IO_URING
+
+IoUring::~IoUring()
+{
+    if(m_sqes)
+        munmap(m_sqes, m_sqesSize);
+    if(m_cqRing && m_cqRing != m_sqRing)
+        munmap(m_cqRing, m_cqRingSize);
+    if(m_sqRing)
+        munmap(m_sqRing, m_sqRingSize);
+    if(m_ringFd >= 0)
+        close(m_ringFd);
+}
+
+bool IoUring::init(unsigned _entries)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    const auto ringFd = static_cast<int>(syscall(__NR_io_uring_setup, _entries, &params));
+    if(ringFd < 0)
+        return false;
+    m_ringFd = ringFd;
+
+    // IORING_OP_READ/WRITE appeared in 5.6 together with this feature flag
+    if(!(params.features & IORING_FEAT_RW_CUR_POS))
+        return false;
+
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(singleMmap)
+        m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+
+    void * sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQ_RING);
+    if(sqRing == MAP_FAILED)
+        return false;
+    m_sqRing = sqRing;
+
+    if(singleMmap)
+    {
+        m_cqRing = m_sqRing;
+    }
+    else
+    {
+        void * cqRing = mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_CQ_RING);
+        if(cqRing == MAP_FAILED)
+            return false;
+        m_cqRing = cqRing;
+    }
+
+    m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void * sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQES);
+    if(sqes == MAP_FAILED)
+        return false;
+    m_sqes = sqes;
+
+    auto * sqBase = static_cast<std::uint8_t *>(m_sqRing);
+    m_sqHead = reinterpret_cast<unsigned *>(sqBase + params.sq_off.head);
+    m_sqTail = reinterpret_cast<unsigned *>(sqBase + params.sq_off.tail);
+    m_sqMask = reinterpret_cast<unsigned *>(sqBase + params.sq_off.ring_mask);
+    m_sqArray = reinterpret_cast<unsigned *>(sqBase + params.sq_off.array);
+    m_sqEntries = params.sq_entries;
+
+    auto * cqBase = static_cast<std::uint8_t *>(m_cqRing);
+    m_cqHead = reinterpret_cast<unsigned *>(cqBase + params.cq_off.head);
+    m_cqTail = reinterpret_cast<unsigned *>(cqBase + params.cq_off.tail);
+    m_cqMask = reinterpret_cast<unsigned *>(cqBase + params.cq_off.ring_mask);
+    m_cqes = cqBase + params.cq_off.cqes;
+
+    return true;
+}
+
+bool IoUring::queue(std::uint8_t _opcode, int _fileDescriptor, void * _buffer, std::size_t _size, std::uint64_t _offset, std::uint64_t _userData)
+{
+    // Kernel advances head as it consumes entries
+    const unsigned tail = *m_sqTail;
+    const unsigned head = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+    if(tail - head >= m_sqEntries)
+        return false;
+
+    const unsigned index = tail & *m_sqMask;
+    auto * sqe = static_cast<io_uring_sqe *>(m_sqes) + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = _opcode;
+    sqe->fd = _fileDescriptor;
+    sqe->addr = reinterpret_cast<std::uint64_t>(_buffer);
+    sqe->len = static_cast<std::uint32_t>(std::min<std::size_t>(_size, 1u << 30)); // Short transfer is completed by caller
+    sqe->off = _offset;
+    sqe->user_data = _userData;
+
+    m_sqArray[index] = index;
+    __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+    ++m_toSubmit;
+    return true;
+}
+
+bool IoUring::submit()
+{
+    if(m_toSubmit == 0)
+        return true;
+
+    // Requests not accepted now stay queued and are submitted with the next call
+    const int submitted = enter(m_toSubmit, 0, 0);
+    if(submitted < 0)
+        return false;
+    m_toSubmit -= static_cast<unsigned>(submitted);
+    m_inFlight += static_cast<unsigned>(submitted);
+    return true;
+}
+
+bool IoUring::takeCompletion(std::uint64_t & _userData, std::int32_t & _result, bool _wait)
+{
+    for(;;)
+    {
+        const unsigned head = *m_cqHead;
+        const unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        if(head != tail)
+        {
+            const auto * cqe = static_cast<const io_uring_cqe *>(m_cqes) + (head & *m_cqMask);
+            _userData = cqe->user_data;
+            _result = cqe->res;
+            __atomic_store_n(m_cqHead, head + 1, __ATOMIC_RELEASE);
+            --m_inFlight;
+            return true;
+        }
+
+        // Requests still queued are submitted together with waiting
+        if(!_wait)
+            return false;
+
+        const int submitted = enter(m_toSubmit, 1, IORING_ENTER_GETEVENTS);
+        if(submitted < 0)
+            return false;
+        m_toSubmit -= static_cast<unsigned>(submitted);
+        m_inFlight += static_cast<unsigned>(submitted);
+    }
+}
+
+void IoUring::discardUnsubmitted()
+{
+    // Kernel reads entries up to tail only inside io_uring_enter, so unsubmitted ones can be taken back
+    __atomic_store_n(m_sqTail, *m_sqTail - m_toSubmit, __ATOMIC_RELEASE);
+    m_toSubmit = 0;
+}
+
+int IoUring::enter(unsigned _toSubmit, unsigned _minComplete, unsigned _flags)
+{
+    for(;;)
+    {
+        const auto result = static_cast<int>(syscall(__NR_io_uring_enter, m_ringFd, _toSubmit, _minComplete, _flags, nullptr, 0));
+        if(result >= 0)
+            return result;
+
+        // Kernel is temporarily out of resources, completions being reaped free them
+        if(errno == EAGAIN || errno == EBUSY)
+            return 0;
+        if(errno != EINTR)
+            return result;
+    }
+}
+
+#else
+
+IoUring::~IoUring() = default;
+
+void IoUring::discardUnsubmitted()
+{
+}
+
+bool IoUring::init(unsigned)
+{
+    return false;
+}
+
+bool IoUring::queue(std::uint8_t, int, void *, std::size_t, std::uint64_t, std::uint64_t)
+{
+    return false;
+}
+
+bool IoUring::submit()
+{
+    return false;
+}
+
+bool IoUring::takeCompletion(std::uint64_t &, std::int32_t &, bool)
+{
+    return false;
+}
+
+int IoUring::enter(unsigned, unsigned, unsigned)
+{
+    return -1;
+}
+
+#endif
+
+bool IoUring::isInitialized() const
+{
+    return m_ringFd >= 0 && m_sqes != nullptr;
+}
+
+unsigned IoUring::getInFlight() const
+{
+    return m_inFlight;
+}
+
+bool IoUring::queueRead(int _fileDescriptor, void * _buffer, std::size_t _size, std::uint64_t _offset, std::uint64_t _userData)
+{
+#ifdef POCKETBOOK_HAS_IO_URING
+    return queue(IORING_OP_READ, _fileDescriptor, _buffer, _size, _offset, _userData);
+#else
+    return queue(0, _fileDescriptor, _buffer, _size, _offset, _userData);
+#endif
+}
+
+bool IoUring::queueWrite(int _fileDescriptor, const void * _buffer, std::size_t _size, std::uint64_t _offset, std::uint64_t _userData)
+{
+#ifdef POCKETBOOK_HAS_IO_URING
+    return queue(IORING_OP_WRITE, _fileDescriptor, const_cast<void *>(_buffer), _size, _offset, _userData);
+#else
+    return queue(0, _fileDescriptor, const_cast<void *>(_buffer), _size, _offset, _userData);
+#endif
+}
+
+bool IoUring::queueCancel(std::uint64_t _targetUserData, std::uint64_t _userData)
+{
+#ifdef POCKETBOOK_HAS_IO_URING
+    // Target is identified by its user data passed in addr
+    return queue(IORING_OP_ASYNC_CANCEL, -1, reinterpret_cast<void *>(static_cast<std::uintptr_t>(_targetUserData)), 0, 0, _userData);
+#else
+    return queue(0, -1, nullptr, 0, _targetUserData, _userData);
+#endif
+}
+
+} // namespace PocketBook
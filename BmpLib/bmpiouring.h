@@ -0,0 +1,73 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace PocketBook {
+
+// Minimal io_uring submission/completion ring over raw syscalls, used by BatchConverter.
+// Available only on Linux built with POCKETBOOK_HAS_IO_URING, init() fails otherwise
+// or when kernel forbids io_uring, so the caller falls back to blocking I/O.
+class IoUring
+{
+public:
+    IoUring() = default;
+    ~IoUring();
+
+    IoUring(const IoUring &) = delete;
+    IoUring & operator=(const IoUring &) = delete;
+
+    bool init(unsigned _entries);
+    bool isInitialized() const;
+
+    // Queue read/write of _size bytes at _offset, false when submission queue is full
+    bool queueRead(int _fileDescriptor, void * _buffer, std::size_t _size, std::uint64_t _offset, std::uint64_t _userData);
+    bool queueWrite(int _fileDescriptor, const void * _buffer, std::size_t _size, std::uint64_t _offset, std::uint64_t _userData);
+
+    // Queue cancellation of submitted request with _targetUserData, it completes with -ECANCELED
+    // unless it has already finished, the cancellation itself completes with _userData
+    bool queueCancel(std::uint64_t _targetUserData, std::uint64_t _userData);
+
+    // Drops requests queued but not submitted yet, kernel never sees them
+    void discardUnsubmitted();
+
+    // Requests submitted to kernel whose completions are not taken yet
+    unsigned getInFlight() const;
+
+    // Submits queued requests to kernel, false on failure
+    bool submit();
+
+    // Takes next completion, blocks until one is available when _wait is true.
+    // _result is the number of bytes transferred or negative errno.
+    bool takeCompletion(std::uint64_t & _userData, std::int32_t & _result, bool _wait);
+
+private:
+    bool queue(std::uint8_t _opcode, int _fileDescriptor, void * _buffer, std::size_t _size, std::uint64_t _offset, std::uint64_t _userData);
+    int enter(unsigned _toSubmit, unsigned _minComplete, unsigned _flags);
+
+    int m_ringFd = -1;
+    unsigned m_toSubmit = 0;
+    unsigned m_inFlight = 0;
+
+    void * m_sqRing = nullptr;
+    std::size_t m_sqRingSize = 0;
+    void * m_cqRing = nullptr;
+    std::size_t m_cqRingSize = 0;
+    void * m_sqes = nullptr;
+    std::size_t m_sqesSize = 0;
+
+    unsigned * m_sqHead = nullptr;
+    unsigned * m_sqTail = nullptr;
+    unsigned * m_sqMask = nullptr;
+    unsigned * m_sqArray = nullptr;
+    unsigned m_sqEntries = 0;
+
+    unsigned * m_cqHead = nullptr;
+    unsigned * m_cqTail = nullptr;
+    unsigned * m_cqMask = nullptr;
+    void * m_cqes = nullptr;
+};
+
+} // namespace PocketBook
@@ -0,0 +1,297 @@
+// Copyright PocketBook - Interview Task
+
+#include "bmpkernels.h"
+#include "bmpdefs.h"
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define POCKETBOOK_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace PocketBook::Kernels {
+
+namespace {
+
+using IsWhiteRowFunc = bool (*)(const std::uint8_t *, std::size_t, std::uint8_t);
+using ClassifyBlocksFunc = void (*)(const std::uint8_t *, std::size_t, std::uint32_t, std::uint32_t, std::uint64_t &, std::uint64_t &);
+
+bool isWhitePaddingScalar(const std::uint8_t * _padding, std::size_t _size)
+{
+    for(std::size_t i = 0; i < _size; ++i)
+    {
+        if(_padding[i] != BLACK_PIXEL)
+            return false;
+    }
+    return true;
+}
+
+bool isWhiteScalar(const std::uint8_t * _data, std::size_t _size, std::uint8_t _whitePixel)
+{
+    const std::uint64_t white8Pixels = _whitePixel * 0x0101010101010101ull;
+
+    std::size_t i = 0;
+    for(; i + sizeof(std::uint64_t) <= _size; i += sizeof(std::uint64_t))
+    {
+        std::uint64_t word;
+        memcpy(&word, _data + i, sizeof(word));
+        if(word != white8Pixels)
+            return false;
+    }
+    for(; i < _size; ++i)
+    {
+        if(_data[i] != _whitePixel)
+            return false;
+    }
+    return true;
+}
+
+void classifyBlocksScalar(
+        const std::uint8_t * _blocks
+    ,   std::size_t _count
+    ,   std::uint32_t _whiteBlock
+    ,   std::uint32_t _blackBlock
+    ,   std::uint64_t & _whiteMask
+    ,   std::uint64_t & _blackMask
+    )
+{
+    std::uint64_t whiteMask = 0;
+    std::uint64_t blackMask = 0;
+    for(std::size_t i = 0; i < _count; ++i)
+    {
+        std::uint32_t block;
+        memcpy(&block, _blocks + i * sizeof(block), sizeof(block));
+        whiteMask |= static_cast<std::uint64_t>(block == _whiteBlock) << i;
+        blackMask |= static_cast<std::uint64_t>(block == _blackBlock) << i;
+    }
+    _whiteMask = whiteMask;
+    _blackMask = blackMask;
+}
+
+#ifdef POCKETBOOK_X86_SIMD
+
+// Vector kernels flip bits of pixels so that white becomes 0xFF and compare them to all ones,
+// flip is zero for the default white pixel
+
+__attribute__((target("sse4.1")))
+bool isWhiteSse41(const std::uint8_t * _data, std::size_t _size, std::uint8_t _whitePixel)
+{
+    static constexpr std::size_t VECTOR_SIZE = sizeof(__m128i);
+    if(_size < VECTOR_SIZE)
+        return isWhiteScalar(_data, _size, _whitePixel);
+
+    const __m128i ones = _mm_set1_epi8(static_cast<char>(0xFF));
+    const __m128i flip = _mm_set1_epi8(static_cast<char>(_whitePixel ^ 0xFF));
+    std::size_t i = 0;
+    for(; i + VECTOR_SIZE <= _size; i += VECTOR_SIZE)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_data + i));
+        if(!_mm_testc_si128(_mm_xor_si128(v, flip), ones))
+            return false;
+    }
+
+    // Tail is checked by overlapping the last full vector
+    if(i < _size)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_data + _size - VECTOR_SIZE));
+        return _mm_testc_si128(_mm_xor_si128(v, flip), ones);
+    }
+    return true;
+}
+
+__attribute__((target("avx2")))
+bool isWhiteAvx2(const std::uint8_t * _data, std::size_t _size, std::uint8_t _whitePixel)
+{
+    static constexpr std::size_t VECTOR_SIZE = sizeof(__m256i);
+    if(_size < VECTOR_SIZE)
+        return isWhiteSse41(_data, _size, _whitePixel);
+
+    const __m256i ones = _mm256_set1_epi8(static_cast<char>(0xFF));
+    const __m256i flip = _mm256_set1_epi8(static_cast<char>(_whitePixel ^ 0xFF));
+    const auto * data = reinterpret_cast<const __m256i *>(_data);
+    std::size_t i = 0;
+
+    // Four vectors are reduced with AND before a single test
+    for(; i + 4 * VECTOR_SIZE <= _size; i += 4 * VECTOR_SIZE, data += 4)
+    {
+        const __m256i v0 = _mm256_xor_si256(_mm256_loadu_si256(data), flip);
+        const __m256i v1 = _mm256_xor_si256(_mm256_loadu_si256(data + 1), flip);
+        const __m256i v2 = _mm256_xor_si256(_mm256_loadu_si256(data + 2), flip);
+        const __m256i v3 = _mm256_xor_si256(_mm256_loadu_si256(data + 3), flip);
+        if(!_mm256_testc_si256(_mm256_and_si256(_mm256_and_si256(v0, v1), _mm256_and_si256(v2, v3)), ones))
+            return false;
+    }
+    for(; i + VECTOR_SIZE <= _size; i += VECTOR_SIZE)
+    {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(_data + i));
+        if(!_mm256_testc_si256(_mm256_xor_si256(v, flip), ones))
+            return false;
+    }
+
+    // Tail is checked by overlapping the last full vector
+    if(i < _size)
+    {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(_data + _size - VECTOR_SIZE));
+        return _mm256_testc_si256(_mm256_xor_si256(v, flip), ones);
+    }
+    return true;
+}
+
+__attribute__((target("sse4.1")))
+void classifyBlocksSse41(
+        const std::uint8_t * _blocks
+    ,   std::size_t _count
+    ,   std::uint32_t _whiteBlock
+    ,   std::uint32_t _blackBlock
+    ,   std::uint64_t & _whiteMask
+    ,   std::uint64_t & _blackMask
+    )
+{
+    static constexpr std::size_t BLOCKS_PER_VECTOR = sizeof(__m128i) / sizeof(std::uint32_t);
+
+    const __m128i white = _mm_set1_epi32(static_cast<int>(_whiteBlock));
+    const __m128i black = _mm_set1_epi32(static_cast<int>(_blackBlock));
+
+    std::uint64_t whiteMask = 0;
+    std::uint64_t blackMask = 0;
+    std::size_t i = 0;
+    for(; i + BLOCKS_PER_VECTOR <= _count; i += BLOCKS_PER_VECTOR)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_blocks + i * sizeof(std::uint32_t)));
+        const auto w = static_cast<std::uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, white))));
+        const auto b = static_cast<std::uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, black))));
+        whiteMask |= w << i;
+        blackMask |= b << i;
+    }
+
+    std::uint64_t tailWhite = 0;
+    std::uint64_t tailBlack = 0;
+    if(i < _count)
+        classifyBlocksScalar(_blocks + i * sizeof(std::uint32_t), _count - i, _whiteBlock, _blackBlock, tailWhite, tailBlack);
+
+    _whiteMask = whiteMask | (i < _count ? tailWhite << i : 0);
+    _blackMask = blackMask | (i < _count ? tailBlack << i : 0);
+}
+
+__attribute__((target("avx2")))
+void classifyBlocksAvx2(
+        const std::uint8_t * _blocks
+    ,   std::size_t _count
+    ,   std::uint32_t _whiteBlock
+    ,   std::uint32_t _blackBlock
+    ,   std::uint64_t & _whiteMask
+    ,   std::uint64_t & _blackMask
+    )
+{
+    static constexpr std::size_t BLOCKS_PER_VECTOR = sizeof(__m256i) / sizeof(std::uint32_t);
+
+    const __m256i white = _mm256_set1_epi32(static_cast<int>(_whiteBlock));
+    const __m256i black = _mm256_set1_epi32(static_cast<int>(_blackBlock));
+
+    std::uint64_t whiteMask = 0;
+    std::uint64_t blackMask = 0;
+    std::size_t i = 0;
+    for(; i + BLOCKS_PER_VECTOR <= _count; i += BLOCKS_PER_VECTOR)
+    {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(_blocks + i * sizeof(std::uint32_t)));
+        const auto w = static_cast<std::uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, white))));
+        const auto b = static_cast<std::uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, black))));
+        whiteMask |= w << i;
+        blackMask |= b << i;
+    }
+
+    std::uint64_t tailWhite = 0;
+    std::uint64_t tailBlack = 0;
+    if(i < _count)
+        classifyBlocksSse41(_blocks + i * sizeof(std::uint32_t), _count - i, _whiteBlock, _blackBlock, tailWhite, tailBlack);
+
+    _whiteMask = whiteMask | (i < _count ? tailWhite << i : 0);
+    _blackMask = blackMask | (i < _count ? tailBlack << i : 0);
+}
+
+#endif // POCKETBOOK_X86_SIMD
+
+SimdLevel detectSimdLevel()
+{
+#ifdef POCKETBOOK_X86_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return SimdLevel::Avx2;
+    if(__builtin_cpu_supports("sse4.1"))
+        return SimdLevel::Sse41;
+#endif
+    return SimdLevel::Scalar;
+}
+
+IsWhiteRowFunc selectIsWhite()
+{
+    switch(getSimdLevel())
+    {
+#ifdef POCKETBOOK_X86_SIMD
+    case SimdLevel::Avx2:
+        return &isWhiteAvx2;
+    case SimdLevel::Sse41:
+        return &isWhiteSse41;
+#endif
+    default:
+        return &isWhiteScalar;
+    }
+}
+
+ClassifyBlocksFunc selectClassifyBlocks()
+{
+    switch(getSimdLevel())
+    {
+#ifdef POCKETBOOK_X86_SIMD
+    case SimdLevel::Avx2:
+        return &classifyBlocksAvx2;
+    case SimdLevel::Sse41:
+        return &classifyBlocksSse41;
+#endif
+    default:
+        return &classifyBlocksScalar;
+    }
+}
+
+} // namespace
+
+SimdLevel getSimdLevel()
+{
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+const char * getSimdLevelName(SimdLevel _level)
+{
+    switch(_level)
+    {
+    case SimdLevel::Avx2:
+        return "AVX2";
+    case SimdLevel::Sse41:
+        return "SSE4.1";
+    default:
+        return "Scalar";
+    }
+}
+
+bool isWhiteRow(const std::uint8_t * _row, std::size_t _width, std::size_t _padding, std::uint8_t _whitePixel)
+{
+    static const IsWhiteRowFunc isWhite = selectIsWhite();
+    return isWhite(_row, _width, _whitePixel) && isWhitePaddingScalar(_row + _width, _padding);
+}
+
+void classifyBlocks(
+        const std::uint8_t * _blocks
+    ,   std::size_t _count
+    ,   std::uint32_t _whiteBlock
+    ,   std::uint32_t _blackBlock
+    ,   std::uint64_t & _whiteMask
+    ,   std::uint64_t & _blackMask
+    )
+{
+    static const ClassifyBlocksFunc classify = selectClassifyBlocks();
+    classify(_blocks, _count, _whiteBlock, _blackBlock, _whiteMask, _blackMask);
+}
+
+} // namespace PocketBook::Kernels
@@ -0,0 +1,59 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace PocketBook::Kernels {
+
+// Instruction set used by the kernels, detected once at runtime
+enum class SimdLevel
+{
+    Scalar,
+    Sse41,
+    Avx2
+};
+
+SimdLevel getSimdLevel();
+const char * getSimdLevelName(SimdLevel _level);
+
+// Returns true when first _width bytes of _row are _whitePixel
+// and following _padding bytes are zero, i.e. row matches BmpRowIndex white row
+bool isWhiteRow(const std::uint8_t * _row, std::size_t _width, std::size_t _padding, std::uint8_t _whitePixel);
+
+// Maximum number of 4 pixel blocks classified by a single classifyBlocks() call
+static constexpr std::size_t CLASSIFY_BLOCKS_MAX = 64;
+
+// Classifies up to CLASSIFY_BLOCKS_MAX 4 pixel blocks starting at _blocks.
+// Bit i of _whiteMask is set when block i is _whiteBlock,
+// bit i of _blackMask is set when block i is _blackBlock, other blocks are literals.
+void classifyBlocks(
+        const std::uint8_t * _blocks
+    ,   std::size_t _count
+    ,   std::uint32_t _whiteBlock
+    ,   std::uint32_t _blackBlock
+    ,   std::uint64_t & _whiteMask
+    ,   std::uint64_t & _blackMask
+    );
+
+// Number of consecutive set bits starting from the lowest one
+inline unsigned countTrailingOnes(std::uint64_t _value)
+{
+    const std::uint64_t inverted = ~_value;
+    if(inverted == 0)
+        return 64;
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, inverted);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(inverted));
+#endif
+}
+
+} // namespace PocketBook::Kernels
@@ -0,0 +1,83 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+namespace PocketBook {
+
+struct OperationStatistics;
+
+// Flag shared between an operation and whoever wants to stop it, cancel() may be called from any thread
+class CancellationToken
+{
+public:
+    void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+    bool isCancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> m_cancelled{false};
+};
+
+// Whether compression codes runs of white and black blocks inside non-white rows by count
+enum class RunLengthCoding
+{
+    Auto,   // Used when sampled rows give smaller output with it
+    Off,
+    On
+};
+
+// Options controlling compress/decompress operations
+struct CodecOptions
+{
+    // Number of worker threads, 0 - use all hardware threads.
+    // Decompression runs in parallel only for files with band table.
+    unsigned ThreadCount = 1;
+
+    // Number of rows encoded into separate band of compressed data.
+    // 0 - single band for ThreadCount = 1, otherwise chosen automatically.
+    std::uint32_t RowsPerBand = 0;
+
+    // Pixels coded by a single code: 4, 8 or 16.
+    // 0 - chosen by sampling rows of the image, wider blocks only when they give smaller output.
+    // Widths other than 4 and run length coding need 'FRMT' chunk, which readers older than it
+    // reject, so both are opt-in and the defaults keep the plain format.
+    unsigned BlockWidth = 4;
+
+    // Sampled together with block width when both are chosen automatically
+    RunLengthCoding RunLength = RunLengthCoding::Off;
+
+    // Operation fails when token is cancelled or deadline passes, both are checked before each row.
+    // Output file of cancelled operation is removed like on any other failure.
+    const CancellationToken * Cancellation = nullptr;
+    std::chrono::steady_clock::time_point Deadline = std::chrono::steady_clock::time_point::max();
+
+    // Filled with timings and counters of the operation when set, see bmpinstrumentation.h.
+    // Block counting costs an extra classification pass over decompressed rows.
+    OperationStatistics * Statistics = nullptr;
+};
+
+// How input file is brought into memory by BmpProxy::createFromBmp/createFromBarch
+enum class ReadStrategy
+{
+    Auto,           // Read for files below SmallFileThreshold, MapWillNeed otherwise
+    Map,            // mmap, pages are faulted in on demand
+    MapSequential,  // mmap with MADV_SEQUENTIAL, aggressive readahead in row order
+    MapWillNeed,    // mmap with MADV_WILLNEED, asynchronous readahead of the whole file
+    MapPopulate,    // mmap with MAP_POPULATE, all pages are mapped before returning
+    ReadHugePages,  // pread into anonymous memory backed by transparent huge pages where available
+    Read            // pread into heap buffer, cheaper than mapping setup for small files
+};
+
+struct ReadOptions
+{
+    ReadStrategy Strategy = ReadStrategy::Auto;
+
+    // Files smaller than this are read instead of mapped by ReadStrategy::Auto
+    std::size_t SmallFileThreshold = 64 * 1024;
+};
+
+} // namespace PocketBook
@@ -0,0 +1,195 @@
+// Copyright PocketBook - Interview Task
+
+#include "bmpoutputsinks.h"
+
+#include <cstring>
+#include <cerrno>
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Writes smaller than this are gathered by FdOutputSink
+static constexpr std::size_t GATHER_BUFFER_SIZE = 64 * 1024;
+
+} // namespace
+
+namespace PocketBook {
+
+FileOutputSink::FileOutputSink(FILE * _file)
+    : m_file(_file), m_origin(ftell(_file))
+{
+}
+
+bool FileOutputSink::write(const void * _data, std::size_t _size)
+{
+    return _size == 0 || fwrite(_data, _size, 1, m_file) == 1;
+}
+
+bool FileOutputSink::isSeekable() const
+{
+    return m_origin >= 0;
+}
+
+bool FileOutputSink::writeAt(std::size_t _offset, const void * _data, std::size_t _size)
+{
+    if(!isSeekable())
+        return false;
+
+    // Sequential writes continue from the end of file
+    return fseek(m_file, m_origin + static_cast<long>(_offset), SEEK_SET) == 0 &&
+           write(_data, _size) &&
+           fseek(m_file, 0, SEEK_END) == 0;
+}
+
+#ifdef __unix__
+
+FdOutputSink::FdOutputSink(int _fileDescriptor)
+    : m_fileDescriptor(_fileDescriptor)
+{
+    m_pending.reserve(GATHER_BUFFER_SIZE);
+}
+
+bool FdOutputSink::write(const void * _data, std::size_t _size)
+{
+    const auto * bytes = static_cast<const std::uint8_t *>(_data);
+    if(m_pending.size() + _size <= GATHER_BUFFER_SIZE)
+    {
+        m_pending.insert(m_pending.end(), bytes, bytes + _size);
+        return true;
+    }
+
+    iovec iov[2];
+    iov[0].iov_base = m_pending.data();
+    iov[0].iov_len = m_pending.size();
+    iov[1].iov_base = const_cast<std::uint8_t *>(bytes);
+    iov[1].iov_len = _size;
+
+    const std::size_t total = m_pending.size() + _size;
+    if(!writeVector(iov, 2, m_position))
+        return false;
+
+    m_position += total;
+    m_pending.clear();
+    return true;
+}
+
+bool FdOutputSink::isSeekable() const
+{
+    return true;
+}
+
+bool FdOutputSink::writeAt(std::size_t _offset, const void * _data, std::size_t _size)
+{
+    if(!flush() || _offset > m_position || _size > m_position - _offset)
+        return false;
+
+    iovec iov;
+    iov.iov_base = const_cast<void *>(_data);
+    iov.iov_len = _size;
+    return writeVector(&iov, 1, _offset);
+}
+
+void FdOutputSink::reserve(std::size_t _totalSize)
+{
+#ifdef __linux__
+    // Only a hint, file systems without fallocate support are written as usual
+    fallocate(m_fileDescriptor, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(_totalSize));
+#else
+    (void)_totalSize;
+#endif
+}
+
+bool FdOutputSink::flush()
+{
+    if(m_pending.empty())
+        return true;
+
+    iovec iov;
+    iov.iov_base = m_pending.data();
+    iov.iov_len = m_pending.size();
+    if(!writeVector(&iov, 1, m_position))
+        return false;
+
+    m_position += m_pending.size();
+    m_pending.clear();
+    return true;
+}
+
+bool FdOutputSink::writeVector(iovec * _iov, int _count, std::size_t _offset)
+{
+    for(;;)
+    {
+        while(_count > 0 && _iov->iov_len == 0)
+        {
+            ++_iov;
+            --_count;
+        }
+        if(_count == 0)
+            return true;
+
+        const ssize_t written = pwritev(m_fileDescriptor, _iov, _count, static_cast<off_t>(_offset));
+        if(written < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            return false;
+        }
+        if(written == 0)
+            return false;
+
+        // Skip buffers written completely and continue from the rest after short write
+        _offset += static_cast<std::size_t>(written);
+        auto remaining = static_cast<std::size_t>(written);
+        while(_count > 0 && remaining >= _iov->iov_len)
+        {
+            remaining -= _iov->iov_len;
+            ++_iov;
+            --_count;
+        }
+        if(_count > 0)
+        {
+            _iov->iov_base = static_cast<std::uint8_t *>(_iov->iov_base) + remaining;
+            _iov->iov_len -= remaining;
+        }
+    }
+}
+
+#endif
+
+VectorOutputSink::VectorOutputSink(std::vector<std::uint8_t> & _output)
+    : m_output(_output), m_origin(_output.size())
+{
+}
+
+bool VectorOutputSink::write(const void * _data, std::size_t _size)
+{
+    const auto * bytes = static_cast<const std::uint8_t *>(_data);
+    m_output.insert(m_output.end(), bytes, bytes + _size);
+    return true;
+}
+
+bool VectorOutputSink::isSeekable() const
+{
+    return true;
+}
+
+bool VectorOutputSink::writeAt(std::size_t _offset, const void * _data, std::size_t _size)
+{
+    if(_offset > m_output.size() - m_origin || _size > m_output.size() - m_origin - _offset)
+        return false;
+
+    if(_size > 0)
+        memcpy(m_output.data() + m_origin + _offset, _data, _size);
+    return true;
+}
+
+void VectorOutputSink::reserve(std::size_t _totalSize)
+{
+    m_output.reserve(m_origin + _totalSize);
+}
+
+} // namespace PocketBook
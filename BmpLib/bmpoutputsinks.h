@@ -0,0 +1,81 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include "bmputils.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#ifdef __unix__
+#include <sys/uio.h>
+#endif
+
+namespace PocketBook {
+
+// Writes output to already opened file
+class FileOutputSink
+    : public IOutputSink
+{
+public:
+    explicit FileOutputSink(FILE * _file /* non-owning */);
+
+    bool write(const void * _data, std::size_t _size) override;
+    bool isSeekable() const override;
+    bool writeAt(std::size_t _offset, const void * _data, std::size_t _size) override;
+
+private:
+    FILE * m_file;
+    long m_origin; // Position of the file when sink was created, -1 for pipes
+
+};
+
+#ifdef __unix__
+
+// Writes output to already opened file descriptor with positional writes bypassing stdio.
+// Small writes (headers, index) are gathered and go out with the next large write
+// in single pwritev, large ones are written straight from caller's memory,
+// e.g. from the mapping of the source file.
+class FdOutputSink
+    : public IOutputSink
+{
+public:
+    explicit FdOutputSink(int _fileDescriptor /* non-owning */);
+
+    bool write(const void * _data, std::size_t _size) override;
+    bool isSeekable() const override;
+    bool writeAt(std::size_t _offset, const void * _data, std::size_t _size) override;
+    void reserve(std::size_t _totalSize) override;
+
+    // Writes gathered data, must be called before the file is closed
+    bool flush();
+
+private:
+    bool writeVector(iovec * _iov, int _count, std::size_t _offset);
+
+    int m_fileDescriptor;
+    std::size_t m_position = 0;
+    std::vector<std::uint8_t> m_pending;
+};
+
+#endif
+
+// Appends output to the vector
+class VectorOutputSink
+    : public IOutputSink
+{
+public:
+    explicit VectorOutputSink(std::vector<std::uint8_t> & _output);
+
+    bool write(const void * _data, std::size_t _size) override;
+    bool isSeekable() const override;
+    bool writeAt(std::size_t _offset, const void * _data, std::size_t _size) override;
+    void reserve(std::size_t _totalSize) override;
+
+private:
+    std::vector<std::uint8_t> & m_output;
+    std::size_t m_origin;
+};
+
+} // namespace PocketBook
@@ -0,0 +1,110 @@
+// Copyright PocketBook - Interview Task
+
+#include "bmpparallel.h"
+
+#include <algorithm>
+
+namespace PocketBook::Parallel {
+
+unsigned resolveThreadCount(unsigned _requested)
+{
+    if(_requested != 0)
+        return _requested;
+
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+WorkerPool::WorkerPool(unsigned _threadCount)
+{
+    // Calling thread takes tasks as well, so it isn't started
+    for(unsigned i = 1; i < _threadCount; ++i)
+        m_threads.emplace_back(&WorkerPool::runWorker, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wakeUp.notify_all();
+
+    for(auto & thread : m_threads)
+        thread.join();
+}
+
+void WorkerPool::parallelFor(std::size_t _count, const std::function<void(std::size_t)> & _task)
+{
+    if(m_threads.empty() || _count <= 1)
+    {
+        for(std::size_t i = 0; i < _count; ++i)
+            _task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &_task;
+        m_count = _count;
+        m_nextTask = 0;
+        m_failed = false;
+        m_error = nullptr;
+        m_busyWorkers = m_threads.size();
+        ++m_generation;
+    }
+    m_wakeUp.notify_all();
+
+    runTasks();
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_finished.wait(lock, [this] { return m_busyWorkers == 0; });
+        m_task = nullptr;
+        error = m_error;
+    }
+
+    if(error)
+        std::rethrow_exception(error);
+}
+
+void WorkerPool::runWorker()
+{
+    unsigned generation = 0;
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait(lock, [&] { return m_stopping || m_generation != generation; });
+            if(m_stopping)
+                return;
+            generation = m_generation;
+        }
+
+        runTasks();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(--m_busyWorkers == 0)
+            m_finished.notify_one();
+    }
+}
+
+void WorkerPool::runTasks()
+{
+    for(std::size_t i = m_nextTask++; i < m_count && !m_failed; i = m_nextTask++)
+    {
+        try
+        {
+            (*m_task)(i);
+        }
+        catch( ... )
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!m_error)
+                m_error = std::current_exception();
+            m_failed = true;
+        }
+    }
+}
+
+} // namespace PocketBook::Parallel
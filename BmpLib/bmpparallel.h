@@ -0,0 +1,57 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace PocketBook::Parallel {
+
+// Returns number of threads to use, 0 is resolved to hardware concurrency
+unsigned resolveThreadCount(unsigned _requested);
+
+// Threads kept alive for the whole operation, so each parallelFor() only wakes them
+// instead of creating new threads. Calling thread counts as one of _threadCount.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(unsigned _threadCount);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool & operator = (const WorkerPool &) = delete;
+
+    // Runs _task(i) for each i in [0, _count) on the pool threads and the calling thread.
+    // Tasks are taken in ascending order. The first exception thrown by a task is rethrown
+    // after all threads finish. Must not be called concurrently.
+    void parallelFor(std::size_t _count, const std::function<void(std::size_t)> & _task);
+
+private:
+    void runWorker();
+    void runTasks();
+
+private:
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::condition_variable m_finished;
+    unsigned m_generation = 0;  // Incremented for each parallelFor, wakes the workers
+    std::size_t m_busyWorkers = 0;
+    bool m_stopping = false;
+
+    // Current parallelFor, published to workers under m_mutex
+    const std::function<void(std::size_t)> * m_task = nullptr;
+    std::size_t m_count = 0;
+    std::atomic<std::size_t> m_nextTask{0};
+    std::atomic<bool> m_failed{false};
+    std::exception_ptr m_error;
+};
+
+} // namespace PocketBook::Parallel
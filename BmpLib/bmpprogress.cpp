@@ -0,0 +1,137 @@
+// Copyright PocketBook - Interview Task
+
+#include "bmpprogress.h"
+#include "bmpexceptions.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace PocketBook {
+
+ProgressReporter::ProgressReporter(IProgressNotifier * _notifier, int _min, int _max)
+    : m_notifier(_notifier), m_min(_min), m_max(_max)
+{
+    if(!m_notifier)
+        return;
+
+    m_policy = m_notifier->getProgressPolicy();
+    if(m_policy.MinPercentDelta > 0)
+    {
+        const long long range = static_cast<long long>(m_max) - m_min;
+        m_stepThreshold = std::max(1, static_cast<int>(range * m_policy.MinPercentDelta / 100));
+    }
+    m_nextNotify.store(m_min, std::memory_order_relaxed);
+    m_notifier->init(m_min, m_max);
+}
+
+void ProgressReporter::step()
+{
+    if(!m_notifier)
+        return;
+
+    if(m_policy.DemoThrottle.count() > 0)
+        std::this_thread::sleep_for(m_policy.DemoThrottle);
+
+    const int current = m_min + m_stepsDone.fetch_add(1, std::memory_order_relaxed);
+    const bool isLast = current + 1 >= m_max;
+    if(!isLast && current < m_nextNotify.load(std::memory_order_relaxed))
+        return;
+
+    if(m_policy.MinInterval.count() == 0 || isLast)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        notify(current);
+        return;
+    }
+
+    // Threads don't wait for each other, the busy one reports progress
+    std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+    if(!lock.owns_lock())
+        return;
+
+    const auto now = std::chrono::steady_clock::now();
+    if(now - m_lastNotifyTime < m_policy.MinInterval)
+        return;
+
+    m_lastNotifyTime = now;
+    notify(current);
+}
+
+void ProgressReporter::notify(int _current)
+{
+    // Steps of parallel workers may come out of order, progress never goes back
+    if(_current <= m_lastNotified)
+        return;
+
+    m_lastNotified = _current;
+    m_nextNotify.store(_current + m_stepThreshold, std::memory_order_relaxed);
+    m_notifier->notifyProgress(_current);
+}
+
+CancellationCheck::CancellationCheck(const CodecOptions & _options)
+    : m_token(_options.Cancellation)
+    , m_deadline(_options.Deadline)
+    , m_enabled(m_token || m_deadline != std::chrono::steady_clock::time_point::max())
+{
+}
+
+void CancellationCheck::checkSlow() const
+{
+    if(m_token && m_token->isCancelled())
+        throw OperationCancelledError();
+
+    if(m_deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= m_deadline)
+        throw OperationCancelledError();
+}
+
+AtomicProgressNotifier::AtomicProgressNotifier(int _minPercentDelta)
+    : m_minPercentDelta(_minPercentDelta)
+{
+}
+
+void AtomicProgressNotifier::init(int _min, int _max)
+{
+    m_min.store(_min, std::memory_order_relaxed);
+    m_max.store(_max, std::memory_order_relaxed);
+    m_current.store(_min, std::memory_order_release);
+}
+
+void AtomicProgressNotifier::notifyProgress(int _current)
+{
+    m_current.store(_current, std::memory_order_release);
+}
+
+ProgressPolicy AtomicProgressNotifier::getProgressPolicy() const
+{
+    ProgressPolicy policy;
+    policy.MinPercentDelta = m_minPercentDelta;
+    return policy;
+}
+
+int AtomicProgressNotifier::getMin() const
+{
+    return m_min.load(std::memory_order_relaxed);
+}
+
+int AtomicProgressNotifier::getMax() const
+{
+    return m_max.load(std::memory_order_relaxed);
+}
+
+int AtomicProgressNotifier::getCurrent() const
+{
+    return m_current.load(std::memory_order_acquire);
+}
+
+int AtomicProgressNotifier::getPercent() const
+{
+    const long long min = getMin();
+    const long long max = getMax();
+    const long long current = getCurrent();
+    if(max <= min)
+        return 100;
+
+    return static_cast<int>((current - min) * 100 / (max - min));
+}
+
+} // namespace PocketBook
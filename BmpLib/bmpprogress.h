@@ -0,0 +1,86 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include "bmputils.h"
+#include "bmpoptions.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace PocketBook {
+
+// ProgressReporter forwards processed steps of an operation to IProgressNotifier
+// applying notifier's ProgressPolicy. step() can be called from several threads.
+class ProgressReporter
+{
+public:
+    ProgressReporter(IProgressNotifier * _notifier, int _min, int _max);
+
+    void step();
+
+private:
+    void notify(int _current);
+
+    IProgressNotifier * m_notifier;
+    ProgressPolicy m_policy;
+    int m_min;
+    int m_max;
+
+    // Steps below m_nextNotify are skipped without taking the lock
+    int m_stepThreshold = 1;
+    std::atomic<int> m_nextNotify{0};
+
+    std::atomic<int> m_stepsDone{0};
+    std::mutex m_mutex;
+    int m_lastNotified = -1;
+    std::chrono::steady_clock::time_point m_lastNotifyTime;
+};
+
+// CancellationCheck stops an operation by CodecOptions::Cancellation or CodecOptions::Deadline.
+// check() is called before each row and throws OperationCancelledError, it is free when neither is set.
+class CancellationCheck
+{
+public:
+    explicit CancellationCheck(const CodecOptions & _options);
+
+    void check() const
+    {
+        if(m_enabled)
+            checkSlow();
+    }
+
+private:
+    void checkSlow() const;
+
+    const CancellationToken * m_token;
+    std::chrono::steady_clock::time_point m_deadline;
+    bool m_enabled;
+};
+
+// AtomicProgressNotifier keeps the latest progress in atomics instead of forwarding it.
+// Workers publish progress without locks or cross-thread calls, consumer (e.g. UI timer)
+// polls getPercent() at its own rate.
+class AtomicProgressNotifier : public IProgressNotifier
+{
+public:
+    explicit AtomicProgressNotifier(int _minPercentDelta = 1);
+
+    void init(int _min, int _max) override;
+    void notifyProgress(int _current) override;
+    ProgressPolicy getProgressPolicy() const override;
+
+    int getMin() const;
+    int getMax() const;
+    int getCurrent() const;
+    int getPercent() const;
+
+private:
+    std::atomic<int> m_min{0};
+    std::atomic<int> m_max{100};
+    std::atomic<int> m_current{0};
+    int m_minPercentDelta;
+};
+
+} // namespace PocketBook
@@ -4,24 +4,224 @@
 #include "bmprowindex.h"
 #include "bmpexceptions.h"
 #include "bmputils.h"
+#include "bitwriter.h"
+#include "bitreader.h"
+#include "bmpcodec.h"
+#include "bmpbandtable.h"
+#include "bmpcodecformat.h"
+#include "bmpparallel.h"
+#include "bmpoutputsinks.h"
+#include "bmpkernels.h"
+#include "bmpprogress.h"
+#include "bmpinstrumentation.h"
 #include <vector>
-#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
 #include <cassert>
 #include <memory.h>
 
 namespace
 {
 
+#ifdef __unix__
+
+bool RollbackFile(const std::string & _filePath, int _fileDescriptor)
+{
+    close(_fileDescriptor);
+    return remove(_filePath.c_str()) == 0;
+}
+
+#else
+
 bool RollbackFile(const std::string & _filePath, FILE * _file)
 {
     fclose(_file);
     return remove(_filePath.c_str()) == 0;
 }
 
+#endif
+
+// Creates output file and fills it by _writeOutput, incomplete file is removed
+template<typename WriteOutput>
+bool WriteOutputFile(const std::string & _filePath, WriteOutput && _writeOutput)
+{
+#ifdef __unix__
+    // Positional writes without stdio buffering, see FdOutputSink
+    const int resultFile = open(_filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if(resultFile < 0)
+        throw PocketBook::FileCreationError(_filePath);
+
+    PocketBook::FdOutputSink sink(resultFile);
+    if(!_writeOutput(sink) || !sink.flush())
+    {
+        [[maybe_unused]] const bool r = RollbackFile(_filePath, resultFile);
+        assert(r && "Unable to rollback file correctly");
+        return false;
+    }
+
+    // File completed
+    return close(resultFile) == 0;
+#else
+    FILE * resultFile = fopen(_filePath.c_str(), "wb");
+    if(!resultFile)
+        throw PocketBook::FileCreationError(_filePath);
+
+    PocketBook::FileOutputSink sink(resultFile);
+    if(!_writeOutput(sink))
+    {
+        [[maybe_unused]] const bool r = RollbackFile(_filePath, resultFile);
+        assert(r && "Unable to rollback file correctly");
+        return false;
+    }
+
+    // File completed
+    return fclose(resultFile) == 0;
+#endif
+}
+
+// Distance in rows between remembered bit positions for files without band table
+static constexpr std::size_t ROW_CHECKPOINT_STEP = 64;
+
+// Amount of compressed data collected before it is written to the output
+static constexpr std::size_t STREAM_CHUNK_SIZE = 1024 * 1024;
+
+// Size of reusable buffer for decompressed rows written to the output
+static constexpr std::size_t DECOMPRESS_CHUNK_SIZE = 4 * 1024 * 1024;
+
 } // namespace
 
 namespace PocketBook {
 
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double GetSecondsSince(Clock::time_point _start)
+{
+    return std::chrono::duration<double>(Clock::now() - _start).count();
+}
+
+// Forwards output to another sink counting written bytes and, when asked, time spent in it
+class MeasuredOutputSink
+    : public IOutputSink
+{
+public:
+    MeasuredOutputSink(IOutputSink & _sink, bool _measureTime)
+        : m_sink(_sink), m_measureTime(_measureTime)
+    {
+    }
+
+    bool write(const void * _data, std::size_t _size) override
+    {
+        m_bytesWritten += _size;
+        return measure([&]{ return m_sink.write(_data, _size); });
+    }
+
+    bool isSeekable() const override
+    {
+        return m_sink.isSeekable();
+    }
+
+    void reserve(std::size_t _totalSize) override
+    {
+        m_sink.reserve(_totalSize);
+    }
+
+    bool writeAt(std::size_t _offset, const void * _data, std::size_t _size) override
+    {
+        return measure([&]{ return m_sink.writeAt(_offset, _data, _size); });
+    }
+
+    std::uint64_t getBytesWritten() const { return m_bytesWritten; }
+    double getSeconds() const { return m_seconds; }
+
+private:
+    template<typename Write>
+    bool measure(Write && _write)
+    {
+        if(!m_measureTime)
+            return _write();
+
+        const auto start = Clock::now();
+        const bool written = _write();
+        m_seconds += GetSecondsSince(start);
+        return written;
+    }
+
+    IOutputSink & m_sink;
+    bool m_measureTime;
+    std::uint64_t m_bytesWritten = 0;
+    double m_seconds = 0.0;
+};
+
+// Resets OperationStatistics when operation starts and fills totals of the sink when it returns
+class StatisticsScope
+{
+public:
+    StatisticsScope(OperationStatistics * _statistics, bool _compress, std::uint64_t _bytesRead, const MeasuredOutputSink & _sink)
+        : m_statistics(_statistics), m_sink(_sink), m_start(Clock::now())
+    {
+        if(!m_statistics)
+            return;
+
+        *m_statistics = OperationStatistics();
+        m_statistics->Compress = _compress;
+        m_statistics->BytesRead = _bytesRead;
+    }
+
+    ~StatisticsScope()
+    {
+        if(!m_statistics)
+            return;
+
+        m_statistics->TotalSeconds = GetSecondsSince(m_start);
+        m_statistics->WriteSeconds = m_sink.getSeconds();
+        m_statistics->BytesWritten = m_sink.getBytesWritten();
+    }
+
+    // Rows loop time without time spent in the sink
+    void startCodec()
+    {
+        m_codecStart = Clock::now();
+        m_codecWriteSeconds = m_sink.getSeconds();
+    }
+
+    void finishCodec()
+    {
+        if(m_statistics)
+            m_statistics->CodecSeconds = GetSecondsSince(m_codecStart) - (m_sink.getSeconds() - m_codecWriteSeconds);
+    }
+
+private:
+    OperationStatistics * m_statistics;
+    const MeasuredOutputSink & m_sink;
+    Clock::time_point m_start;
+    Clock::time_point m_codecStart;
+    double m_codecWriteSeconds = 0.0;
+};
+
+std::uint64_t CountWhiteRows(const BmpRowIndex & _rowIndex, std::size_t _height)
+{
+    std::uint64_t whiteRows = 0;
+    for(std::size_t row = 0; row < _height; ++row)
+        whiteRows += _rowIndex.testRowIsEmpty(row);
+    return whiteRows;
+}
+
+void AddBlockCounts(OperationStatistics & _statistics, const std::vector<Codec::BlockCounts> & _counts)
+{
+    for(const auto & counts : _counts)
+    {
+        _statistics.WhiteBlocks += counts.White;
+        _statistics.BlackBlocks += counts.Black;
+        _statistics.LiteralBlocks += counts.Literal;
+    }
+}
+
+} // namespace
+
 BmpProxy::BmpProxy(std::unique_ptr<ProxyImpl> _pImpl)
     : m_pImpl(std::move(_pImpl))
 {
@@ -34,14 +234,24 @@ BmpProxy::BmpProxy(BmpProxy && _other) noexcept
 
 BmpProxy::~BmpProxy() noexcept = default;
 
-BmpProxy BmpProxy::createFromBmp(const std::string& _filePath)
+BmpProxy BmpProxy::createFromBmp(const std::string& _filePath, const ReadOptions & _readOptions)
+{
+    return BmpProxy(ProxyImpl::readFile(_filePath, false, _readOptions));
+}
+
+BmpProxy BmpProxy::createFromBarch(const std::string& _filePath, const ReadOptions & _readOptions)
+{
+    return BmpProxy(ProxyImpl::readFile(_filePath, true, _readOptions));
+}
+
+BmpProxy BmpProxy::createFromBmp(const std::uint8_t * _data, std::size_t _size)
 {
-    return BmpProxy(ProxyImpl::readFile(_filePath, false));
+    return BmpProxy(ProxyImpl::readMemory(_data, _size, false));
 }
 
-BmpProxy BmpProxy::createFromBarch(const std::string& _filePath)
+BmpProxy BmpProxy::createFromBarch(const std::uint8_t * _data, std::size_t _size)
 {
-    return BmpProxy(ProxyImpl::readFile(_filePath, true));
+    return BmpProxy(ProxyImpl::readMemory(_data, _size, true));
 }
 
 const std::string& BmpProxy::getFilePath() const
@@ -79,6 +289,11 @@ std::size_t BmpProxy::getHeight() const
     return getInfoHeader().Height;
 }
 
+const ReadStatistics & BmpProxy::getReadStatistics() const
+{
+    return m_pImpl->getReadStatistics();
+}
+
 const std::uint8_t * BmpProxy::getPixelData() const
 {
     return m_pImpl->getPixelData();
@@ -100,151 +315,285 @@ bool BmpProxy::provideRawImageData(RawImageData & _out) const
     return true;
 }
 
-bool BmpProxy::compress(const std::string& _outputFilePath, IProgressNotifier * _progressNotifier)
+bool BmpProxy::compress(const std::string& _outputFilePath, IProgressNotifier * _progressNotifier, const CodecOptions & _options)
 {
-    FILE * resultFile = fopen(_outputFilePath.c_str(), "wb");
-    if(!resultFile)
-        throw FileCreationError(_outputFilePath);
+    return WriteOutputFile(_outputFilePath, [&](IOutputSink & _sink)
+    {
+        return compress(_sink, _progressNotifier, _options);
+    });
+}
 
-    auto rollbackFile = [resultFile, &_outputFilePath]()
+bool BmpProxy::compress(std::vector<std::uint8_t> & _output, IProgressNotifier * _progressNotifier, const CodecOptions & _options)
+{
+    _output.clear();
+    VectorOutputSink sink(_output);
+    if(!compress(sink, _progressNotifier, _options))
     {
-        bool r = RollbackFile(_outputFilePath, resultFile);
-        assert(r && "Unable to rollback file correctly");
+        _output.clear();
         return false;
-    };
+    }
+    return true;
+}
 
-    // Copy whole file already compressed
-    if(isCompressed())
+bool BmpProxy::compress(IOutputSink & _sink, IProgressNotifier * _progressNotifier, const CodecOptions & _options)
+{
+    ProxyImpl::OperationFaultsScope faultsScope(*m_pImpl);
+
+    // Headers can't be patched in sink without seeking, so output is staged in memory
+    if(!isCompressed() && !_sink.isSeekable())
     {
-        if(!m_pImpl->copyBytesToFile(resultFile, getFileSize()))
-            return rollbackFile();
+        std::vector<std::uint8_t> stagedOutput;
+        if(!compress(stagedOutput, _progressNotifier, _options))
+            return false;
 
-        fclose(resultFile);
-        return true;
+        const auto writeStart = Clock::now();
+        const bool written = _sink.write(stagedOutput.data(), stagedOutput.size());
+        if(OperationStatistics * statistics = _options.Statistics)
+        {
+            const double writeSeconds = GetSecondsSince(writeStart);
+            statistics->WriteSeconds += writeSeconds;
+            statistics->TotalSeconds += writeSeconds;
+            statistics->PeakBufferBytes += stagedOutput.capacity();
+        }
+        return written;
     }
 
+    MeasuredOutputSink sink(_sink, _options.Statistics != nullptr);
+    StatisticsScope statisticsScope(_options.Statistics, true, getFileSize(), sink);
+
+    // Copy whole file already compressed
+    if(isCompressed())
+        return m_pImpl->copyBytesToSink(sink, getFileSize());
+
     BmpHeader header = getHeader();
     header.Signature = COMPRESSED_SIGNATURE; // Specify 'BA' signature
     header.IndexOffset = header.DataOffset; // Specify Index Offset at DataOffset
 
     RawImageData rawImageData;
     if(!provideRawImageData(rawImageData))
-        return rollbackFile();
+        return false;
 
     try
     {
-        if(_progressNotifier)
-            _progressNotifier->init(0, rawImageData.getActualHeight() << 1);
-
-        auto index = BmpRowIndex::createFromRawImageData(rawImageData, _progressNotifier);
-        header.DataOffset = static_cast<std::uint32_t>(header.IndexOffset + index.getIndexSizeInBytes());
+        ProgressReporter progress(_progressNotifier, 0, rawImageData.getActualHeight());
+        const CancellationCheck cancellation(_options);
+        cancellation.check();
 
         BmpInfoHeader infoHeader = getInfoHeader();
-        DynamicBitset compressedPixelData(infoHeader.ImageSize, 0x00);
-
-        std::size_t currentBitPos = 0;
-        for(int rowIndex = 0; rowIndex < rawImageData.getActualHeight(); ++rowIndex)
+        const int height = rawImageData.getActualHeight();
+        const int padding = rawImageData.getPadding();
+        const std::size_t rowSize = rawImageData.getActualWidth();
+        const std::size_t blocksPerRow = rowSize / sizeof(std::uint32_t);
+
+        // Palette decides which pixels are white and black, sampled rows decide block width
+        // and run length coding unless options fix them
+        const BmpCodecFormat & paletteFormat = m_pImpl->getCodecFormat();
+        std::vector<BmpCodecFormat> formatCandidates;
+        for(const bool runLength : { false, true })
         {
-            const auto * rawPixels = reinterpret_cast<const std::uint32_t*>(
-                rawImageData.Data + rowIndex * rawImageData.getActualWidth()
-                );
-            if(!index.testRowIsEmpty(rowIndex))
+            if(_options.RunLength != (runLength ? RunLengthCoding::Off : RunLengthCoding::On))
             {
-                for(int blockIndex = 0; blockIndex < rawImageData.getActualWidth() / sizeof(std::uint32_t); ++blockIndex)
+                for(const unsigned blockWidth : { 4u, 8u, 16u })
                 {
-                    std::uint32_t blockValue = *rawPixels;
-                    switch(blockValue)
-                    {
-                    case BLACK_4PIXELS:
-                        compressedPixelData.set(currentBitPos++, true);
-                        compressedPixelData.set(currentBitPos++, false);
-                        break;
-
-                    case WHITE_4PIXELS:
-                        compressedPixelData.set(currentBitPos++, false);
-                        break;
-
-                    default:
-                        compressedPixelData.set(currentBitPos++, true);
-                        compressedPixelData.set(currentBitPos++, true);
-
-                        for(int bitIndex = 0; bitIndex < sizeof(std::uint32_t) * DynamicBitset::BITS_PER_BLOCK; ++bitIndex)
-                        {
-                            bool bitValue = (blockValue & (1 << bitIndex)) != 0;
-                            compressedPixelData.set(currentBitPos++, bitValue);
-                        }
-                        break;
-                    }
+                    if(!_options.BlockWidth || _options.BlockWidth == blockWidth)
+                        formatCandidates.push_back(paletteFormat.withBlockWidth(blockWidth).withRunLength(runLength));
+                }
+            }
+        }
+        if(formatCandidates.empty())
+            throw std::invalid_argument(std::string("Unsupported block width: ") + std::to_string(_options.BlockWidth));
+        const BmpCodecFormat codecFormat = Codec::selectFormat(rawImageData, formatCandidates);
+
+        // Bands are encoded independently into separate bit streams
+        const unsigned threadCount = Parallel::resolveThreadCount(_options.ThreadCount);
+        const std::uint32_t rowsPerBand = BmpBandTable::calculateRowsPerBand(height, rowSize, threadCount, _options.RowsPerBand);
+        const std::size_t bandCount = BmpBandTable::getBandCount(height, rowsPerBand);
+
+        // Each band owns whole bytes of the index since rows per band are aligned to index block
+        std::vector<std::uint8_t> indexData(DynamicBitset::getNumBlocksRequired(height), 0x00);
+        std::vector<std::uint32_t> bandOffsets(bandCount, 0);
+
+        // Band offsets are stored only for image split into several bands,
+        // format only when it differs from the default one
+        const std::vector<std::uint8_t> formatChunk = codecFormat.serialize();
+        auto serializeChunks = [&](std::vector<std::uint32_t> && _bandOffsets)
+        {
+            std::vector<std::uint8_t> serialized;
+            if(rowsPerBand)
+                serialized = BmpBandTable(rowsPerBand, std::move(_bandOffsets)).serialize();
+            serialized.insert(serialized.end(), formatChunk.begin(), formatChunk.end());
+            return serialized;
+        };
+        std::vector<std::uint8_t> chunks = serializeChunks(std::vector<std::uint32_t>(bandCount, 0));
+
+        // Sizes, index and band offsets are known only after encoding, so headers, index and chunks
+        // are written as placeholders and patched when all pixel data is written
+        header.DataOffset = static_cast<std::uint32_t>(header.IndexOffset + indexData.size() + chunks.size());
+        if(!m_pImpl->writeHeaders(sink, header, infoHeader, header.IndexOffset) ||
+           !sink.write(indexData.data(), indexData.size()) ||
+           !sink.write(chunks.data(), chunks.size()))
+        {
+            return false;
+        }
 
-                    ++rawPixels;
+        std::size_t compressedSize = 0;
+        auto writeCompleteBytes = [&](BitWriter & _writer)
+        {
+            const std::size_t bytes = _writer.numCompleteBytes();
+            if(!sink.write(_writer.data(), bytes))
+                return false;
+
+            compressedSize += bytes;
+            _writer.discardCompleteBytes();
+            return true;
+        };
+
+        // Each row is classified and encoded in single pass while it is still in cache.
+        // Band encoded alone flushes its output to sink by STREAM_CHUNK_SIZE
+        auto encodeBand = [&](std::size_t _band, BitWriter & _writer, bool _streamOutput, Codec::BlockCounts * _counts)
+        {
+            const int firstRow = rowsPerBand ? static_cast<int>(_band * rowsPerBand) : 0;
+            const int lastRow = rowsPerBand ? std::min(height, static_cast<int>(firstRow + rowsPerBand)) : height;
+
+            std::uint8_t indexBlock = 0x00;
+            for(int rowIndex = firstRow; rowIndex < lastRow; ++rowIndex)
+            {
+                cancellation.check();
+
+                const auto * rawPixels = rawImageData.Data + rowIndex * rowSize;
+                const int bitIndex = rowIndex % DynamicBitset::BITS_PER_BLOCK;
+                if(Kernels::isWhiteRow(rawPixels, rawImageData.Width, padding, codecFormat.getWhitePixel()))
+                    indexBlock |= 1 << bitIndex;
+                else
+                    Codec::encodeRow(rawPixels, blocksPerRow, codecFormat, _writer, _counts);
+
+                if(bitIndex == DynamicBitset::BITS_PER_BLOCK - 1 || rowIndex == lastRow - 1)
+                {
+                    indexData[rowIndex / DynamicBitset::BITS_PER_BLOCK] = indexBlock;
+                    indexBlock = 0x00;
                 }
+
+                if(_streamOutput && _writer.numCompleteBytes() >= STREAM_CHUNK_SIZE && !writeCompleteBytes(_writer))
+                    return false;
+
+                progress.step();
             }
+            _writer.flush();
+            return true;
+        };
+
+        // Up to threadCount bands are encoded at once and written in order, so memory
+        // is bounded by the window of bands instead of the whole compressed image
+        const std::size_t windowSize = std::min<std::size_t>(threadCount, bandCount);
+        const std::size_t reserveBytes = std::min<std::size_t>(infoHeader.ImageSize / bandCount, STREAM_CHUNK_SIZE);
+        std::vector<BitWriter> compressedBands(windowSize, BitWriter(reserveBytes));
+
+        // Each band of the window counts its blocks separately, only when statistics are asked
+        std::vector<Codec::BlockCounts> blockCounts(_options.Statistics ? windowSize : 0);
+        auto getBlockCounts = [&](std::size_t _windowBand)
+        {
+            return blockCounts.empty() ? nullptr : &blockCounts[_windowBand];
+        };
+
+        // Workers live for all windows instead of being started for each of them
+        Parallel::WorkerPool workers(static_cast<unsigned>(windowSize));
 
-            if(_progressNotifier)
+        statisticsScope.startCodec();
+        for(std::size_t windowBegin = 0; windowBegin < bandCount; windowBegin += windowSize)
+        {
+            const std::size_t windowBands = std::min(windowSize, bandCount - windowBegin);
+            if(windowBands == 1)
             {
-                using namespace std::chrono_literals;
-                std::this_thread::sleep_for(1ms); // For progress bar demonstration
-                _progressNotifier->notifyProgress(rawImageData.getActualHeight() + rowIndex);
+                bandOffsets[windowBegin] = static_cast<std::uint32_t>(compressedSize);
+                if(!encodeBand(windowBegin, compressedBands.front(), true, getBlockCounts(0)) || !writeCompleteBytes(compressedBands.front()))
+                    return false;
+                continue;
             }
 
+            // Failed band leaves incomplete data, so the whole output is rolled back like in serial path
+            std::atomic<bool> bandsEncoded{true};
+            workers.parallelFor(windowBands, [&](std::size_t _band)
+            {
+                if(!encodeBand(windowBegin + _band, compressedBands[_band], false, getBlockCounts(_band)))
+                    bandsEncoded.store(false, std::memory_order_relaxed);
+            });
+            if(!bandsEncoded.load(std::memory_order_relaxed))
+                return false;
+
+            for(std::size_t band = 0; band < windowBands; ++band)
+            {
+                bandOffsets[windowBegin + band] = static_cast<std::uint32_t>(compressedSize);
+                if(!writeCompleteBytes(compressedBands[band]))
+                    return false;
+            }
         }
 
-        // Copy header bytes up to index offset
-        if(!m_pImpl->copyBytesToFile(resultFile, header.IndexOffset))
-            return rollbackFile();
+        statisticsScope.finishCodec();
+
+        chunks = serializeChunks(std::move(bandOffsets));
 
-        compressedPixelData.shrinkToFit();
-        infoHeader.ImageSize = static_cast<std::uint32_t>(compressedPixelData.numBlocks());
-        header.FileSize = static_cast<std::uint32_t>(ftell(resultFile) + index.getIndexSizeInBytes() + compressedPixelData.numBlocks());
+        infoHeader.ImageSize = static_cast<std::uint32_t>(compressedSize);
+        header.FileSize = static_cast<std::uint32_t>(header.DataOffset + compressedSize);
 
-        // Write index and compressed pixel data
-        if(fwrite(index.getData(), index.getIndexSizeInBytes(), 1, resultFile) != 1 ||
-           fwrite(compressedPixelData.data(), compressedPixelData.numBlocks(), 1, resultFile) != 1 ||
-           ftell(resultFile) != header.FileSize)
+        // Patch headers, index and chunks with actual values
+        if(!sink.writeAt(0, &header, sizeof(header)) ||
+           !sink.writeAt(INFO_HEADER_OFFSET, &infoHeader, sizeof(infoHeader)) ||
+           !sink.writeAt(header.IndexOffset, indexData.data(), indexData.size()) ||
+           !sink.writeAt(header.IndexOffset + indexData.size(), chunks.data(), chunks.size()))
         {
-            return rollbackFile();
+            return false;
         }
 
-        fseek(resultFile, 0, SEEK_SET);
-        if(fwrite(&header, sizeof(BmpHeader), 1, resultFile) != 1 ||
-           fwrite(&infoHeader, sizeof(BmpInfoHeader), 1, resultFile) != 1)
+        if(OperationStatistics * statistics = _options.Statistics)
         {
-            return rollbackFile();
+            statistics->BlockWidth = codecFormat.getBlockWidth();
+            statistics->RunLength = codecFormat.hasRunLength();
+            statistics->Rows = height;
+            statistics->WhiteRows = CountWhiteRows(BmpRowIndex(height, indexData.data()), height);
+            AddBlockCounts(*statistics, blockCounts);
+
+            statistics->PeakBufferBytes = indexData.size() + chunks.size();
+            for(const auto & writer : compressedBands)
+                statistics->PeakBufferBytes += writer.capacity();
         }
 
-        // File completed
-        fclose(resultFile);
-
     } catch( ... )
     {
-        return rollbackFile();
+        return false;
     }
 
     return true;
 }
 
-bool BmpProxy::decompress(const std::string& _outputFilePath, IProgressNotifier * _progressNotifier)
+bool BmpProxy::decompress(const std::string& _outputFilePath, IProgressNotifier * _progressNotifier, const CodecOptions & _options)
 {
-    FILE * resultFile = fopen(_outputFilePath.c_str(), "wb");
-    if(!resultFile)
-        throw FileCreationError(_outputFilePath);
+    return WriteOutputFile(_outputFilePath, [&](IOutputSink & _sink)
+    {
+        return decompress(_sink, _progressNotifier, _options);
+    });
+}
 
-    auto rollbackFile = [resultFile, &_outputFilePath]()
+bool BmpProxy::decompress(std::vector<std::uint8_t> & _output, IProgressNotifier * _progressNotifier, const CodecOptions & _options)
+{
+    _output.clear();
+    VectorOutputSink sink(_output);
+    if(!decompress(sink, _progressNotifier, _options))
     {
-        bool r = RollbackFile(_outputFilePath, resultFile);
-        assert(r && "Unable to rollback file correctly");
+        _output.clear();
         return false;
-    };
+    }
+    return true;
+}
+
+bool BmpProxy::decompress(IOutputSink & _sink, IProgressNotifier * _progressNotifier, const CodecOptions & _options)
+{
+    ProxyImpl::OperationFaultsScope faultsScope(*m_pImpl);
+    MeasuredOutputSink sink(_sink, _options.Statistics != nullptr);
+    StatisticsScope statisticsScope(_options.Statistics, false, getFileSize(), sink);
 
     // Copy whole file as decompressed
     if(!isCompressed())
-    {
-        if(!m_pImpl->copyBytesToFile(resultFile, getFileSize()))
-            return rollbackFile();
-
-        fclose(resultFile);
-        return true;
-    }
+        return m_pImpl->copyBytesToSink(sink, getFileSize());
 
     BmpHeader header = getHeader();
     header.Signature = UNCOMPRESSED_SIGNATURE; // Specify 'BM' signature
@@ -257,95 +606,262 @@ bool BmpProxy::decompress(const std::string& _outputFilePath, IProgressNotifier
         std::uint32_t compressedImageSize = infoHeader.ImageSize;
 
         int padding = RawImageData::calculatePadding(infoHeader.Width);
-        const auto whiteRowPattern = BmpRowIndex::getWhiteRowPattern(infoHeader.Width);
+        const BmpCodecFormat & codecFormat = m_pImpl->getCodecFormat();
+        const auto whiteRowPattern = BmpRowIndex::getWhiteRowPattern(infoHeader.Width, codecFormat.getWhitePixel());
+
+        const std::size_t rowSize = infoHeader.Width + padding;
+        const std::size_t height = infoHeader.Height;
+        const std::size_t resultImageSize = height * rowSize;
 
-        DynamicBitset pixelDataCompressed(getPixelData(), compressedImageSize);
+        ProgressReporter progress(_progressNotifier, 0, static_cast<int>(infoHeader.Height));
+        const CancellationCheck cancellation(_options);
+        cancellation.check();
 
-        std::size_t resultImageSize = infoHeader.Height * (infoHeader.Width + padding);
-        std::vector<std::uint8_t> resultPixelData(resultImageSize, 0x00);
-        std::uint8_t * currentRowPtr = resultPixelData.data();
-        std::uint32_t currentBitPos = 0;
+        infoHeader.ImageSize = static_cast<std::uint32_t>(resultImageSize);
+        header.FileSize = static_cast<std::uint32_t>(header.DataOffset + resultImageSize);
 
-        if(_progressNotifier)
-            _progressNotifier->init(0, infoHeader.Height);
+        // Write header bytes up to original data offset, Pixel Data is written as it is decoded
+        sink.reserve(header.FileSize);
+        if(!m_pImpl->writeHeaders(sink, header, infoHeader, header.DataOffset))
+            return false;
 
-        for(int rowIndex = 0; rowIndex < static_cast<int>(infoHeader.Height); ++rowIndex)
+        // Bands are decoded in parallel when file provides band table,
+        // otherwise the whole image is decoded as single band
+        const auto * bmpRowIndex = m_pImpl->getRowIndex();
+        const auto * bandTable = m_pImpl->getBandTable();
+        const std::size_t bandCount = bandTable ? bandTable->getBandCount() : 1;
+
+        // Parallel window buffers whole bands, rows per band come from the file, so bands
+        // larger than DECOMPRESS_CHUNK_SIZE are decoded sequentially by chunks instead
+        const bool bandsFitChunk = bandTable && bandTable->getRowsPerBand() * rowSize <= DECOMPRESS_CHUNK_SIZE;
+        const unsigned threadCount = bandsFitChunk ? Parallel::resolveThreadCount(_options.ThreadCount) : 1;
+
+        auto getBandFirstRow = [&](std::size_t _band) -> std::size_t
+        {
+            return bandTable ? bandTable->getBandFirstRow(_band) : 0;
+        };
+
+        auto getBandRowCount = [&](std::size_t _band) -> std::size_t
         {
-            const auto * bmpRowIndex = m_pImpl->getRowIndex();
-            if(bmpRowIndex && bmpRowIndex->testRowIsEmpty(rowIndex))
+            return bandTable ? bandTable->getBandRowCount(_band, height) : height;
+        };
+
+        auto getBandReader = [&](std::size_t _band)
+        {
+            std::size_t bandBegin = 0;
+            std::size_t bandEnd = compressedImageSize;
+            if(bandTable)
             {
-                memcpy(currentRowPtr, whiteRowPattern.data(), whiteRowPattern.size());
-                currentRowPtr += whiteRowPattern.size();
+                bandBegin = bandTable->getBandOffset(_band);
+                if(_band + 1 < bandCount)
+                    bandEnd = bandTable->getBandOffset(_band + 1);
+            }
+            return BitReader(getPixelData() + bandBegin, bandEnd - bandBegin);
+        };
+
+        auto decodeRow = [&](BitReader & _reader, std::size_t _rowIndex, std::uint8_t * _dest, Codec::BlockCounts * _counts)
+        {
+            cancellation.check();
+
+            if(bmpRowIndex && bmpRowIndex->testRowIsEmpty(_rowIndex))
+            {
+                memcpy(_dest, whiteRowPattern.data(), whiteRowPattern.size());
             }
             else
             {
-                int numBytesRestored = 0;
-                while(numBytesRestored < static_cast<int>(infoHeader.Width + padding))
+                Codec::decodeRow(_reader, _dest, rowSize / sizeof(std::uint32_t), codecFormat);
+                if(_reader.overrun())
+                    throw InvalidPixelDataError("Compressed data is truncated");
+
+                // Decoded row is still in cache, classifying it again is cheaper than counting codes while decoding
+                if(_counts)
+                    Codec::countBlocks(_dest, rowSize / sizeof(std::uint32_t), codecFormat, *_counts);
+            }
+
+            progress.step();
+        };
+
+        // Rows are decoded into reusable buffer written to sink when it is filled up,
+        // so memory doesn't depend on image size. Several threads decode a window of
+        // bands at once, the buffer holds the whole window then, at most DECOMPRESS_CHUNK_SIZE
+        // per thread.
+        const std::size_t windowSize = std::min<std::size_t>(threadCount, bandCount);
+        const std::size_t bufferRows = windowSize > 1
+            ? windowSize * bandTable->getRowsPerBand()
+            : std::max<std::size_t>(DECOMPRESS_CHUNK_SIZE / std::max<std::size_t>(rowSize, 1), 1);
+        std::vector<std::uint8_t> resultPixelData(std::min(bufferRows, height) * rowSize, 0x00);
+
+        // Each band of the window counts its blocks separately, only when statistics are asked
+        std::vector<Codec::BlockCounts> blockCounts(_options.Statistics ? windowSize : 0);
+        auto getBlockCounts = [&](std::size_t _windowBand)
+        {
+            return blockCounts.empty() ? nullptr : &blockCounts[_windowBand];
+        };
+
+        statisticsScope.startCodec();
+
+        if(windowSize <= 1)
+        {
+            std::size_t bufferedRows = 0;
+            for(std::size_t band = 0; band < bandCount; ++band)
+            {
+                BitReader pixelDataCompressed = getBandReader(band);
+                const std::size_t firstRow = getBandFirstRow(band);
+                for(std::size_t rowIndex = firstRow; rowIndex < firstRow + getBandRowCount(band); ++rowIndex)
                 {
-                    std::uint32_t block = BLACK_4PIXELS;
-                    bool b0 = pixelDataCompressed.test(currentBitPos++);
-                    if(b0 == false)
-                    {
-                        block = WHITE_4PIXELS;
-                    }
-                    else
+                    decodeRow(pixelDataCompressed, rowIndex, resultPixelData.data() + bufferedRows * rowSize, getBlockCounts(0));
+                    if(++bufferedRows == bufferRows)
                     {
-                        bool b1 = pixelDataCompressed.test(currentBitPos++);
-                        if(b1 == true)
-                        {
-                            for(int i = 0; i < sizeof(std::uint32_t) * DynamicBitset::BITS_PER_BLOCK; ++i)
-                            {
-                                if(pixelDataCompressed.test(currentBitPos++))
-                                    block |= 1 << i;
-                            }
-                        }
+                        if(!sink.write(resultPixelData.data(), bufferedRows * rowSize))
+                            return false;
+                        bufferedRows = 0;
                     }
-
-                    memcpy(currentRowPtr, &block, sizeof(block));
-                    currentRowPtr += sizeof(block);
-                    numBytesRestored += sizeof(block);
                 }
             }
 
-            if(_progressNotifier)
+            if(!sink.write(resultPixelData.data(), bufferedRows * rowSize))
+                return false;
+        }
+        else
+        {
+            // Workers live for all windows instead of being started for each of them
+            Parallel::WorkerPool workers(static_cast<unsigned>(windowSize));
+            for(std::size_t windowBegin = 0; windowBegin < bandCount; windowBegin += windowSize)
             {
-                using namespace std::chrono_literals;
-                std::this_thread::sleep_for(2ms); // For progress bar demonstration
-                _progressNotifier->notifyProgress(rowIndex);
+                const std::size_t windowBands = std::min(windowSize, bandCount - windowBegin);
+                const std::size_t windowFirstRow = getBandFirstRow(windowBegin);
+
+                workers.parallelFor(windowBands, [&](std::size_t _band)
+                {
+                    const std::size_t band = windowBegin + _band;
+                    const std::size_t firstRow = getBandFirstRow(band);
+                    BitReader pixelDataCompressed = getBandReader(band);
+                    std::uint8_t * currentRowPtr = resultPixelData.data() + (firstRow - windowFirstRow) * rowSize;
+                    for(std::size_t rowIndex = firstRow; rowIndex < firstRow + getBandRowCount(band); ++rowIndex)
+                    {
+                        decodeRow(pixelDataCompressed, rowIndex, currentRowPtr, getBlockCounts(_band));
+                        currentRowPtr += rowSize;
+                    }
+                });
+
+                const std::size_t lastBand = windowBegin + windowBands - 1;
+                const std::size_t windowRows = getBandFirstRow(lastBand) + getBandRowCount(lastBand) - windowFirstRow;
+                if(!sink.write(resultPixelData.data(), windowRows * rowSize))
+                    return false;
             }
         }
+        statisticsScope.finishCodec();
 
-        pixelDataCompressed.clear();
+        if(OperationStatistics * statistics = _options.Statistics)
+        {
+            statistics->BlockWidth = codecFormat.getBlockWidth();
+            statistics->RunLength = codecFormat.hasRunLength();
+            statistics->Rows = height;
+            statistics->WhiteRows = bmpRowIndex ? CountWhiteRows(*bmpRowIndex, height) : 0;
+            AddBlockCounts(*statistics, blockCounts);
+            statistics->PeakBufferBytes = resultPixelData.size();
+        }
 
-        if(!m_pImpl->copyBytesToFile(resultFile, header.DataOffset))
-            return rollbackFile();
+    } catch ( ... )
+    {
+        return false;
+    }
 
-        infoHeader.ImageSize = static_cast<std::uint32_t>(resultImageSize);
-        header.FileSize = static_cast<std::uint32_t>(ftell(resultFile) + resultImageSize);
+    return true;
+}
+
+void BmpProxy::decodeRows(std::size_t _firstRow, std::size_t _count, std::uint8_t * _dest, std::size_t _destStride)
+{
+    decodeRegion(ImageRegion{0, _firstRow, getWidth(), _count}, _dest, _destStride);
+}
+
+void BmpProxy::decodeRegion(const ImageRegion & _region, std::uint8_t * _dest, std::size_t _destStride)
+{
+    const std::size_t width = getWidth();
+    const std::size_t height = getHeight();
+    if(_region.X > width || _region.Width > width - _region.X ||
+       _region.Y > height || _region.Height > height - _region.Y)
+    {
+        throw std::out_of_range("Region is out of image bounds");
+    }
+
+    if(_region.Width == 0 || _region.Height == 0)
+        return;
+
+    const std::size_t destStride = _destStride ? _destStride : _region.Width;
+    const std::size_t rowSize = width + RawImageData::calculatePadding(static_cast<int>(width));
+    const std::size_t lastRow = _region.Y + _region.Height;
 
-        // Write Pixel Data decompressed
-        if(fwrite(resultPixelData.data(), resultPixelData.size(), 1, resultFile) != 1 ||
-           ftell(resultFile) != header.FileSize)
+    // Bmp rows are copied from the mapped pixel data
+    if(!isCompressed())
+    {
+        for(std::size_t rowIndex = _region.Y; rowIndex < lastRow; ++rowIndex, _dest += destStride)
+            memcpy(_dest, getPixelData() + rowIndex * rowSize + _region.X, _region.Width);
+        return;
+    }
+
+    const auto * bmpRowIndex = m_pImpl->getRowIndex();
+    const auto * bandTable = m_pImpl->getBandTable();
+    const BmpCodecFormat & codecFormat = m_pImpl->getCodecFormat();
+    const std::size_t compressedImageSize = getInfoHeader().ImageSize;
+    auto & rowCheckpoints = m_pImpl->getRowCheckpoints();
+
+    // Start decoding from the band containing the first row, or the nearest remembered row position
+    std::size_t rowIndex = 0;
+    std::size_t bandEnd = compressedImageSize;
+    BitReader pixelDataCompressed(getPixelData(), compressedImageSize);
+    if(bandTable)
+    {
+        const std::size_t band = _region.Y / bandTable->getRowsPerBand();
+        rowIndex = bandTable->getBandFirstRow(band);
+        if(band + 1 < bandTable->getBandCount())
+            bandEnd = bandTable->getBandOffset(band + 1);
+        pixelDataCompressed = BitReader(getPixelData() + bandTable->getBandOffset(band), bandEnd - bandTable->getBandOffset(band));
+    }
+    else if(!rowCheckpoints.empty())
+    {
+        const std::size_t checkpoint = std::min(_region.Y / ROW_CHECKPOINT_STEP, rowCheckpoints.size() - 1);
+        rowIndex = checkpoint * ROW_CHECKPOINT_STEP;
+        pixelDataCompressed.seek(rowCheckpoints[checkpoint]);
+    }
+
+    std::vector<std::uint8_t> rowBuffer(rowSize);
+    for(; rowIndex < lastRow; ++rowIndex)
+    {
+        if(bandTable && rowIndex % bandTable->getRowsPerBand() == 0)
         {
-            return rollbackFile();
+            const std::size_t band = rowIndex / bandTable->getRowsPerBand();
+            const std::size_t bandBegin = bandTable->getBandOffset(band);
+            bandEnd = band + 1 < bandTable->getBandCount() ? bandTable->getBandOffset(band + 1) : compressedImageSize;
+            pixelDataCompressed = BitReader(getPixelData() + bandBegin, bandEnd - bandBegin);
+        }
+        else if(!bandTable && rowIndex % ROW_CHECKPOINT_STEP == 0 && rowIndex / ROW_CHECKPOINT_STEP == rowCheckpoints.size())
+        {
+            rowCheckpoints.push_back(pixelDataCompressed.position());
         }
 
-        fseek(resultFile, 0, SEEK_SET);
-        if(fwrite(&header, sizeof(BmpHeader), 1, resultFile) != 1 ||
-           fwrite(&infoHeader, sizeof(BmpInfoHeader), 1, resultFile) != 1)
+        const bool isRequested = rowIndex >= _region.Y;
+        if(bmpRowIndex && bmpRowIndex->testRowIsEmpty(rowIndex))
+        {
+            if(isRequested)
+                memset(_dest, codecFormat.getWhitePixel(), _region.Width);
+        }
+        else if(isRequested)
         {
-            return rollbackFile();
+            Codec::decodeRow(pixelDataCompressed, rowBuffer.data(), rowSize / sizeof(std::uint32_t), codecFormat);
+            memcpy(_dest, rowBuffer.data() + _region.X, _region.Width);
+        }
+        else
+        {
+            Codec::skipRow(pixelDataCompressed, rowSize / sizeof(std::uint32_t), codecFormat);
         }
 
-        // File completed
-        fclose(resultFile);
+        if(pixelDataCompressed.overrun())
+            throw InvalidPixelDataError("Compressed data is truncated");
 
-    } catch ( ... )
-    {
-        return rollbackFile();
+        if(isRequested)
+            _dest += destStride;
     }
-
-    return true;
 }
 
 } // namespace PocketBook
@@ -5,19 +5,29 @@
 #include <cstdint>
 #include <string>
 #include <memory>
+#include <vector>
+
+#include "bmpoptions.h"
 
 namespace PocketBook {
 
 struct IProgressNotifier;
+struct IOutputSink;
 struct BmpHeader;
 struct BmpInfoHeader;
 struct RawImageData;
+struct ImageRegion;
+struct ReadStatistics;
 
 class BmpProxy
 {
 public:
-    static BmpProxy createFromBmp(const std::string& _filePath);
-    static BmpProxy createFromBarch(const std::string& _filePath);
+    static BmpProxy createFromBmp(const std::string& _filePath, const ReadOptions & _readOptions = ReadOptions());
+    static BmpProxy createFromBarch(const std::string& _filePath, const ReadOptions & _readOptions = ReadOptions());
+
+    // Creates proxy over image in memory, the data is not copied and must outlive the proxy
+    static BmpProxy createFromBmp(const std::uint8_t * _data, std::size_t _size);
+    static BmpProxy createFromBarch(const std::uint8_t * _data, std::size_t _size);
 
     BmpProxy(BmpProxy && _other) noexcept;
     BmpProxy& operator = (const BmpProxy & _other) = delete;
@@ -33,11 +43,50 @@ public:
     std::size_t getWidth() const;
     std::size_t getHeight() const;
 
+    // Read strategy of the input and page faults taken by reading and the last compress/decompress
+    const ReadStatistics & getReadStatistics() const;
+
     const std::uint8_t * getPixelData() const;
     bool provideRawImageData(RawImageData & _out) const;
 
-    bool compress(const std::string& _outputFilePath, IProgressNotifier * _progressNotifier = nullptr);
-    bool decompress(const std::string& _outputFilePath, IProgressNotifier * _progressNotifier = nullptr);
+    bool compress(
+            const std::string& _outputFilePath
+        ,   IProgressNotifier * _progressNotifier = nullptr
+        ,   const CodecOptions & _options = CodecOptions()
+    );
+    bool compress(
+            std::vector<std::uint8_t> & _output
+        ,   IProgressNotifier * _progressNotifier = nullptr
+        ,   const CodecOptions & _options = CodecOptions()
+    );
+    bool compress(
+            IOutputSink & _sink
+        ,   IProgressNotifier * _progressNotifier = nullptr
+        ,   const CodecOptions & _options = CodecOptions()
+    );
+    bool decompress(
+            const std::string& _outputFilePath
+        ,   IProgressNotifier * _progressNotifier = nullptr
+        ,   const CodecOptions & _options = CodecOptions()
+    );
+    bool decompress(
+            std::vector<std::uint8_t> & _output
+        ,   IProgressNotifier * _progressNotifier = nullptr
+        ,   const CodecOptions & _options = CodecOptions()
+    );
+    bool decompress(
+            IOutputSink & _sink
+        ,   IProgressNotifier * _progressNotifier = nullptr
+        ,   const CodecOptions & _options = CodecOptions()
+    );
+
+    // Decodes _count rows starting from _firstRow into _dest without padding.
+    // Rows are in file order, each row starts _destStride bytes after previous one (0 - image width).
+    // Only compressed data of the bands covering requested rows is read.
+    void decodeRows(std::size_t _firstRow, std::size_t _count, std::uint8_t * _dest, std::size_t _destStride = 0);
+
+    // Decodes pixels of _region into _dest, each row starts _destStride bytes after previous one (0 - region width)
+    void decodeRegion(const ImageRegion & _region, std::uint8_t * _dest, std::size_t _destStride = 0);
 
 private:
     class ProxyImpl;
@@ -2,23 +2,63 @@
 
 #include "bmpproxyimpl.h"
 #include "bmprowindex.h"
+#include "bmpbandtable.h"
 #include "bmpexceptions.h"
 
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
 namespace PocketBook {
 
+namespace {
+
+#ifdef __unix__
+
+bool readWhole(int _fileHandle, std::uint8_t * _dest, std::size_t _size)
+{
+    std::size_t offset = 0;
+    while(offset < _size)
+    {
+        const ssize_t bytesRead = pread(_fileHandle, _dest + offset, _size - offset, static_cast<off_t>(offset));
+        if(bytesRead < 0 && errno == EINTR)
+            continue;
+        if(bytesRead <= 0)
+            return false;
+        offset += static_cast<std::size_t>(bytesRead);
+    }
+    return true;
+}
+
+#endif
+
+} // namespace
+
 // Bmp Proxy Impl
+BmpProxy::ProxyImpl::OperationFaultsScope::OperationFaultsScope(ProxyImpl & _impl)
+    : m_impl(_impl), m_start(getProcessPageFaults())
+{
+}
+
+
+BmpProxy::ProxyImpl::OperationFaultsScope::~OperationFaultsScope()
+{
+    m_impl.setLastOperationFaults(getProcessPageFaults() - m_start);
+}
+
+
 BmpProxy::ProxyImpl::ProxyImpl() = default;
 
 
 BmpProxy::ProxyImpl::~ProxyImpl()
 {
 #ifdef __unix__
-    if(m_pHeader)
+    if(m_pHeader && m_isMapped)
         munmap(m_pHeader, m_fileSize);
     if(m_fileHandle)
         close(m_fileHandle);
 #elif _WIN32
-    if(m_pHeader)
+    if(m_pHeader && m_isMapped)
         UnmapViewOfFile(m_pHeader);
     if(m_fileMappingHandle)
         CloseHandle(m_fileMappingHandle);
@@ -29,8 +69,10 @@ BmpProxy::ProxyImpl::~ProxyImpl()
 
 
 std::unique_ptr<BmpProxy::ProxyImpl>
-BmpProxy::ProxyImpl::readFile(const std::string & _filePath, bool _isCompressed)
+BmpProxy::ProxyImpl::readFile(const std::string & _filePath, bool _isCompressed, const ReadOptions & _readOptions)
 {
+    const PageFaultCounts faultsBefore = getProcessPageFaults();
+
     std::unique_ptr<ProxyImpl> impl = std::make_unique<ProxyImpl>();
     impl->m_filePath = _filePath;
 
@@ -48,12 +90,66 @@ BmpProxy::ProxyImpl::readFile(const std::string & _filePath, bool _isCompressed)
     impl->m_fileHandle = fileHandle;
     impl->m_fileSize = statbuf.st_size;
 
-    // Map opened file to memory
-    auto headerPtr = mmap(0, impl->m_fileSize, PROT_READ, MAP_PRIVATE, impl->m_fileHandle, 0);
-    if (headerPtr == MAP_FAILED)
-        throw FileOpeningError(_filePath);
+    // Every strategy reads headers in place, so shorter file is rejected before reading it
+    if(impl->m_fileSize < INFO_HEADER_OFFSET + sizeof(BmpInfoHeader))
+        throw InvalidBmpHeaderError("Unable to read Header");
+
+    ReadStrategy strategy = _readOptions.Strategy;
+    if(strategy == ReadStrategy::Auto)
+        strategy = impl->m_fileSize < _readOptions.SmallFileThreshold ? ReadStrategy::Read : ReadStrategy::MapWillNeed;
+    impl->m_readStatistics.Strategy = strategy;
+
+    if(strategy == ReadStrategy::Read)
+    {
+        // Small file is copied into heap buffer, cheaper than setting up any mapping.
+        // Buffer isn't zero initialized, it is overwritten by the read anyway
+        impl->m_readBuffer.reset(new std::uint8_t[impl->m_fileSize]);
+        impl->m_pHeader = impl->m_readBuffer.get();
 
-    impl->m_pHeader = headerPtr;
+        if(!readWhole(impl->m_fileHandle, impl->getHeaderStart(), impl->m_fileSize))
+            throw FileOpeningError(_filePath);
+
+        close(impl->m_fileHandle);
+        impl->m_fileHandle = 0;
+    }
+    else if(strategy == ReadStrategy::ReadHugePages)
+    {
+        // Anonymous mapping can be backed by huge pages, descriptor isn't needed afterwards
+        auto headerPtr = mmap(0, impl->m_fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (headerPtr == MAP_FAILED)
+            throw FileOpeningError(_filePath);
+
+        impl->m_pHeader = headerPtr;
+        impl->m_isMapped = true;
+
+#ifdef MADV_HUGEPAGE
+        // Only a hint, ignored when transparent huge pages are disabled
+        madvise(headerPtr, impl->m_fileSize, MADV_HUGEPAGE);
+#endif
+
+        if(!readWhole(impl->m_fileHandle, impl->getHeaderStart(), impl->m_fileSize))
+            throw FileOpeningError(_filePath);
+
+        close(impl->m_fileHandle);
+        impl->m_fileHandle = 0;
+    }
+    else
+    {
+        // Map opened file to memory
+        const int flags = strategy == ReadStrategy::MapPopulate ? MAP_PRIVATE | MAP_POPULATE : MAP_PRIVATE;
+        auto headerPtr = mmap(0, impl->m_fileSize, PROT_READ, flags, impl->m_fileHandle, 0);
+        if (headerPtr == MAP_FAILED)
+            throw FileOpeningError(_filePath);
+
+        impl->m_pHeader = headerPtr;
+        impl->m_isMapped = true;
+
+        // Access hints are advisory, failure doesn't affect reading
+        if(strategy == ReadStrategy::MapSequential)
+            madvise(headerPtr, impl->m_fileSize, MADV_SEQUENTIAL);
+        else if(strategy == ReadStrategy::MapWillNeed)
+            madvise(headerPtr, impl->m_fileSize, MADV_WILLNEED);
+    }
 
 #elif _WIN32
 
@@ -67,6 +163,9 @@ BmpProxy::ProxyImpl::readFile(const std::string & _filePath, bool _isCompressed)
 
     impl->m_fileSize = static_cast<std::size_t>(file_size.QuadPart);
 
+    if(impl->m_fileSize < INFO_HEADER_OFFSET + sizeof(BmpInfoHeader))
+        throw InvalidBmpHeaderError("Unable to read Header");
+
     // Map opened file to memory
     impl->m_fileMappingHandle = CreateFileMappingA(impl->m_fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
     if(!impl->m_fileMappingHandle)
@@ -74,25 +173,115 @@ BmpProxy::ProxyImpl::readFile(const std::string & _filePath, bool _isCompressed)
     impl->m_pHeader = MapViewOfFile(impl->m_fileMappingHandle, FILE_MAP_READ, 0, 0, impl->m_fileSize);
     if(!impl->m_pHeader)
         throw FileOpeningError(_filePath);
+    impl->m_isMapped = true;
+
+    // Mapping is the only strategy implemented for Windows
+    (void)_readOptions;
+    impl->m_readStatistics.Strategy = ReadStrategy::Map;
 
 #endif
 
+    readImage(*impl, _isCompressed);
+
+    impl->m_readStatistics.OpenFaults = getProcessPageFaults() - faultsBefore;
+    return impl;
+}
+
+
+std::unique_ptr<BmpProxy::ProxyImpl>
+BmpProxy::ProxyImpl::readMemory(const std::uint8_t * _data, std::size_t _size, bool _isCompressed)
+{
+    std::unique_ptr<ProxyImpl> impl = std::make_unique<ProxyImpl>();
+
+    if(!_data || _size < INFO_HEADER_OFFSET + sizeof(BmpInfoHeader))
+        throw InvalidBmpHeaderError("Unable to read Header");
+
+    // Caller's memory is used in place, same as mapped file
+    impl->m_fileSize = _size;
+    impl->m_pHeader = const_cast<std::uint8_t *>(_data);
+
+    readImage(*impl, _isCompressed);
+    return impl;
+}
+
+
+void BmpProxy::ProxyImpl::readImage(BmpProxy::ProxyImpl & _impl, bool _isCompressed)
+{
     // BMP Header validation
-    validateHeader(*impl, impl->m_fileSize, _isCompressed);
+    validateHeader(_impl, _impl.m_fileSize, _isCompressed);
 
     // BMP Info Header validation
-    validateInfoHeader(*impl, impl->m_fileSize);
+    validateInfoHeader(_impl, _impl.m_fileSize);
 
     if(_isCompressed)
     {
         // Read Index Data
-        impl->m_index = std::make_unique<BmpRowIndex>(
-            impl->getInfoHeader()->Height
-            ,   impl->getHeaderStart() + impl->getBmpHeader()->IndexOffset
+        _impl.m_index = std::make_unique<BmpRowIndex>(
+                _impl.getInfoHeader()->Height
+            ,   _impl.getHeaderStart() + _impl.getBmpHeader()->IndexOffset
             );
+
+        // Read optional chunks located between Index Data and Pixel Data
+        readChunks(_impl);
     }
+    else
+    {
+        readColorTable(_impl);
+    }
+}
 
-    return impl;
+void BmpProxy::ProxyImpl::readChunks(BmpProxy::ProxyImpl & _impl)
+{
+    const auto * bmpHeader = _impl.getBmpHeader();
+    const auto * infoHeader = _impl.getInfoHeader();
+
+    std::size_t chunkOffset = bmpHeader->IndexOffset + _impl.m_index->getIndexSizeInBytes();
+    if(chunkOffset > bmpHeader->DataOffset)
+        throw InvalidBmpHeaderError(std::string("Invalid Data Offset: ") + std::to_string(bmpHeader->DataOffset));
+
+    while(chunkOffset + sizeof(BarchChunkHeader) <= bmpHeader->DataOffset)
+    {
+        BarchChunkHeader chunkHeader;
+        memcpy(&chunkHeader, _impl.getHeaderStart() + chunkOffset, sizeof(chunkHeader));
+
+        const std::size_t payloadOffset = chunkOffset + sizeof(chunkHeader);
+        if(payloadOffset + chunkHeader.Size > bmpHeader->DataOffset)
+            throw InvalidBmpHeaderError(std::string("Invalid chunk size: ") + std::to_string(chunkHeader.Size));
+
+        // Unknown chunks are skipped
+        if(chunkHeader.Tag == BAND_TABLE_TAG)
+        {
+            _impl.m_bandTable = std::make_unique<BmpBandTable>(BmpBandTable::createFromChunk(
+                    _impl.getHeaderStart() + payloadOffset
+                ,   chunkHeader.Size
+                ,   infoHeader->Height
+                ,   infoHeader->ImageSize
+            ));
+        }
+        else if(chunkHeader.Tag == FORMAT_TAG)
+        {
+            _impl.m_codecFormat = BmpCodecFormat::createFromChunk(_impl.getHeaderStart() + payloadOffset, chunkHeader.Size);
+        }
+
+        chunkOffset = payloadOffset + chunkHeader.Size;
+    }
+}
+
+void BmpProxy::ProxyImpl::readColorTable(BmpProxy::ProxyImpl & _impl)
+{
+    static constexpr std::size_t MAX_COLORS = 256;
+    static constexpr std::size_t COLOR_SIZE = sizeof(std::uint32_t);
+
+    const auto * bmpHeader = _impl.getBmpHeader();
+    const auto * infoHeader = _impl.getInfoHeader();
+
+    // Zero ColorsUsed means full table, which is clipped by pixel data like a truncated one
+    const std::size_t colorTableOffset = INFO_HEADER_OFFSET + infoHeader->Size;
+    const std::size_t tableSpace = bmpHeader->DataOffset > colorTableOffset ? bmpHeader->DataOffset - colorTableOffset : 0;
+    const std::size_t colorsUsed = infoHeader->ColorsUsed ? infoHeader->ColorsUsed : MAX_COLORS;
+    const std::size_t colorCount = std::min({ colorsUsed, MAX_COLORS, tableSpace / COLOR_SIZE });
+
+    _impl.m_codecFormat = BmpCodecFormat::createFromColorTable(_impl.getHeaderStart() + colorTableOffset, colorCount);
 }
 
 void BmpProxy::ProxyImpl::validateHeader(BmpProxy::ProxyImpl & _impl, std::size_t _fileSize, bool _isCompressed)
@@ -152,9 +341,13 @@ void BmpProxy::ProxyImpl::validateInfoHeader(BmpProxy::ProxyImpl & _impl, std::s
     const int widthPadding = RawImageData::calculatePadding(width);
     const bool isBarch = (bmpHeader->Signature == COMPRESSED_SIGNATURE);
 
-    if(isBarch && imageSize == 0)
+    if(!isBarch && imageSize != 0 && (height * (width + widthPadding)) != imageSize)
         throw InvalidInfoHeaderError(std::string("Unexpected Image Size: " + std::to_string(imageSize)));
-    else if(!isBarch && imageSize != 0 && (height * (width + widthPadding)) != imageSize)
+
+    if(!isBarch && static_cast<std::size_t>(bmpHeader->DataOffset) + std::size_t(height) * (width + widthPadding) > _fileSize) // Pixel data is read in place
+        throw InvalidInfoHeaderError(std::string("Pixel data exceeds file size"));
+
+    if(isBarch && static_cast<std::size_t>(bmpHeader->DataOffset) + imageSize > _fileSize) // Compressed data is read in place
         throw InvalidInfoHeaderError(std::string("Unexpected Image Size: " + std::to_string(imageSize)));
 
     std::size_t colorTableOffset = INFO_HEADER_OFFSET + size;
@@ -217,12 +410,55 @@ const BmpRowIndex * BmpProxy::ProxyImpl::getRowIndex() const
 }
 
 
-bool BmpProxy::ProxyImpl::copyBytesToFile(FILE * _dest, std::size_t _bytesCount)
+const BmpBandTable * BmpProxy::ProxyImpl::getBandTable() const
+{
+    return m_bandTable.get();
+}
+
+
+const BmpCodecFormat & BmpProxy::ProxyImpl::getCodecFormat() const
+{
+    return m_codecFormat;
+}
+
+
+std::vector<std::size_t> & BmpProxy::ProxyImpl::getRowCheckpoints()
+{
+    return m_rowCheckpoints;
+}
+
+
+const ReadStatistics & BmpProxy::ProxyImpl::getReadStatistics() const
+{
+    return m_readStatistics;
+}
+
+
+void BmpProxy::ProxyImpl::setLastOperationFaults(const PageFaultCounts & _faults)
+{
+    m_readStatistics.LastOperationFaults = _faults;
+}
+
+
+bool BmpProxy::ProxyImpl::copyBytesToSink(IOutputSink & _dest, std::size_t _bytesCount)
+{
+    _dest.reserve(_bytesCount);
+    return _dest.write(getHeaderStart(), _bytesCount);
+}
+
+
+bool BmpProxy::ProxyImpl::writeHeaders(
+        IOutputSink & _dest
+    ,   const BmpHeader & _header
+    ,   const BmpInfoHeader & _infoHeader
+    ,   std::size_t _bytesCount
+    )
 {
-    if(fwrite(getHeaderStart(), _bytesCount, 1, _dest) == 1)
-        return true;
+    static constexpr std::size_t HEADERS_SIZE = INFO_HEADER_OFFSET + sizeof(BmpInfoHeader);
 
-    return false;
+    return _dest.write(&_header, sizeof(_header)) &&
+           _dest.write(&_infoHeader, sizeof(_infoHeader)) &&
+           _dest.write(getHeaderStart() + HEADERS_SIZE, _bytesCount - HEADERS_SIZE);
 }
 
 } // namespace PocketBook
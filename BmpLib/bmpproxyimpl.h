@@ -4,6 +4,12 @@
 
 #include "bmpproxy.h"
 #include "bmpdefs.h"
+#include "bmputils.h"
+#include "bmpinstrumentation.h"
+#include "bmpcodecformat.h"
+
+#include <memory>
+#include <vector>
 
 #ifdef __unix__
 #include <sys/types.h>
@@ -18,14 +24,28 @@
 namespace PocketBook {
 
 class BmpRowIndex;
+class BmpBandTable;
 
 class BmpProxy::ProxyImpl
 {
 public:
+    // Stores page faults taken between construction and destruction as the last operation faults
+    class OperationFaultsScope
+    {
+    public:
+        explicit OperationFaultsScope(ProxyImpl & _impl);
+        ~OperationFaultsScope();
+
+    private:
+        ProxyImpl & m_impl;
+        PageFaultCounts m_start;
+    };
+
     ProxyImpl();
     ~ProxyImpl();
 
-    static std::unique_ptr<ProxyImpl> readFile(const std::string & _filePath, bool _isCompressed);
+    static std::unique_ptr<ProxyImpl> readFile(const std::string & _filePath, bool _isCompressed, const ReadOptions & _readOptions);
+    static std::unique_ptr<ProxyImpl> readMemory(const std::uint8_t * _data, std::size_t _size, bool _isCompressed);
 
     const std::string & getFilePath() const;
     std::size_t getFileSize() const;
@@ -35,16 +55,36 @@ public:
 
     const std::uint8_t * getPixelData() const;
     const BmpRowIndex * getRowIndex() const;
+    const BmpBandTable * getBandTable() const;
+
+    // Resolved from colour table for bmp, read from format chunk for barch
+    const BmpCodecFormat & getCodecFormat() const;
+
+    // Bit positions of every ROW_CHECKPOINT_STEP row collected while decoding files without band table
+    std::vector<std::size_t> & getRowCheckpoints();
+
+    const ReadStatistics & getReadStatistics() const;
+    void setLastOperationFaults(const PageFaultCounts & _faults);
+
+    bool copyBytesToSink(IOutputSink & _dest, std::size_t _bytesCount);
 
-    bool copyBytesToFile(FILE * _dest, std::size_t _bytesCount);
+    // Writes _header and _infoHeader followed by original header bytes up to _bytesCount
+    bool writeHeaders(IOutputSink & _dest, const BmpHeader & _header, const BmpInfoHeader & _infoHeader, std::size_t _bytesCount);
 
 private:
     static void validateHeader(ProxyImpl& _impl, std::size_t _fileSize, bool _isCompressed);
     static void validateInfoHeader(ProxyImpl& _impl, std::size_t _fileSize);
+    static void readChunks(ProxyImpl& _impl);
+    static void readColorTable(ProxyImpl& _impl);
+    static void readImage(ProxyImpl& _impl, bool _isCompressed);
 
     std::string m_filePath;
     std::size_t m_fileSize = 0;
     std::unique_ptr<BmpRowIndex> m_index;
+    std::unique_ptr<BmpBandTable> m_bandTable;
+    BmpCodecFormat m_codecFormat;
+    std::vector<std::size_t> m_rowCheckpoints;
+    ReadStatistics m_readStatistics;
 
 #ifdef __unix__
     int m_fileHandle = 0;
@@ -54,6 +94,8 @@ private:
 #endif
 
     void * m_pHeader = nullptr;
+    bool m_isMapped = false; // false when proxy works over caller's memory or m_readBuffer
+    std::unique_ptr<std::uint8_t[]> m_readBuffer; // File copy of ReadStrategy::Read
     std::uint8_t* getHeaderStart();
     const std::uint8_t* getHeaderStart() const;
 };
@@ -3,12 +3,14 @@
 #include "bmprowindex.h"
 #include "bmpdefs.h"
 #include "bmputils.h"
+#include "bmpkernels.h"
+#include "bmpprogress.h"
 
 #include <cassert>
 #include <stdexcept>
-#include <thread>
 #include <memory.h>
 #include <cstdlib>
+#include <memory>
 
 namespace PocketBook {
 
@@ -86,10 +88,10 @@ const std::uint8_t * BmpRowIndex::getData() const
         return m_index.m_data;
 }
 
-std::vector<std::uint8_t> BmpRowIndex::getWhiteRowPattern(int _width)
+std::vector<std::uint8_t> BmpRowIndex::getWhiteRowPattern(int _width, std::uint8_t _whitePixel)
 {
     int padding = PocketBook::RawImageData::calculatePadding(_width);
-    std::vector<std::uint8_t> whiteRowPattern(_width + padding, WHITE_PIXEL);
+    std::vector<std::uint8_t> whiteRowPattern(_width + padding, _whitePixel);
     for(int i = _width; i < _width + padding; ++i)
         whiteRowPattern[i] = BLACK_PIXEL; // Fill whiteRowPattern with zero padding if needed
 
@@ -99,26 +101,34 @@ std::vector<std::uint8_t> BmpRowIndex::getWhiteRowPattern(int _width)
 BmpRowIndex BmpRowIndex::createFromRawImageData(
         const PocketBook::RawImageData & _raw
     ,   PocketBook::IProgressNotifier * _progressNotifier
+    ,   std::uint8_t _whitePixel
     )
 {
-    const auto whiteRowPattern = BmpRowIndex::getWhiteRowPattern(_raw.Width);
+    const int height = _raw.getActualHeight();
+    const int padding = _raw.getPadding();
+    std::vector<std::uint8_t> indexData(DynamicBitset::getNumBlocksRequired(height), 0x00);
+    ProgressReporter progress(_progressNotifier, 0, height);
 
-    BmpRowIndex index(_raw.getActualHeight());
+    // Row results are packed into the index byte by byte
+    std::uint8_t indexBlock = 0x00;
     const std::uint8_t * rowStartPtr = _raw.Data;
-    for(int rowIndex = 0; rowIndex < _raw.getActualHeight(); ++rowIndex)
+    for(int rowIndex = 0; rowIndex < height; ++rowIndex)
     {
-        index.setRowIsEmpty(rowIndex, memcmp(rowStartPtr, whiteRowPattern.data(), whiteRowPattern.size()) == 0);
+        const int bitIndex = rowIndex % DynamicBitset::BITS_PER_BLOCK;
+        if(Kernels::isWhiteRow(rowStartPtr, _raw.Width, padding, _whitePixel))
+            indexBlock |= 1 << bitIndex;
 
-        rowStartPtr += _raw.getActualWidth();
-        if(_progressNotifier)
+        if(bitIndex == DynamicBitset::BITS_PER_BLOCK - 1 || rowIndex == height - 1)
         {
-            using namespace std::chrono_literals;
-            std::this_thread::sleep_for(1ms); // For progress bar demonstration
-            _progressNotifier->notifyProgress(rowIndex);
+            indexData[rowIndex / DynamicBitset::BITS_PER_BLOCK] = indexBlock;
+            indexBlock = 0x00;
         }
+
+        rowStartPtr += _raw.getActualWidth();
+        progress.step();
     }
 
-    return index;
+    return BmpRowIndex(height, std::move(indexData));
 }
 
 
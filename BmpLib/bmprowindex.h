@@ -3,10 +3,10 @@
 #pragma once
 
 #include "dynamicbitset.h"
+#include "bmpdefs.h"
 
 namespace PocketBook {
 
-struct RawImageData;
 struct IProgressNotifier;
 
 // BmpRowIndex encodes each exact row as separate bit [0:n-1]
@@ -28,11 +28,12 @@ public:
 
     const std::uint8_t * getData() const;
 
-    static std::vector<std::uint8_t> getWhiteRowPattern(int _width);
+    static std::vector<std::uint8_t> getWhiteRowPattern(int _width, std::uint8_t _whitePixel = WHITE_PIXEL);
 
     static BmpRowIndex createFromRawImageData(
             const PocketBook::RawImageData & _raw
         ,   PocketBook::IProgressNotifier * _progressNotifier = nullptr
+        ,   std::uint8_t _whitePixel = WHITE_PIXEL
     );
 
 private:
@@ -2,14 +2,49 @@
 
 #pragma once
 
+#include <cstddef>
+#include <chrono>
+
 namespace PocketBook {
 
+// Policy that notifier may provide to control how progress is reported
+struct ProgressPolicy
+{
+    // Minimal time between two progress notifications, 0 - notify each step.
+    // The last step of operation is always notified.
+    std::chrono::milliseconds MinInterval{0};
+
+    // Minimal progress change in percents of the whole range between two notifications,
+    // 0 - notify each step. Checked without clock and lock on each step.
+    int MinPercentDelta = 0;
+
+    // Delay after each processed step, intended for UI demonstration only
+    std::chrono::microseconds DemoThrottle{0};
+};
+
 // Interface that provides notifications for any long operation
 struct IProgressNotifier
 {
     virtual ~IProgressNotifier() = default;
     virtual void init( int _min, int _max ) = 0;
     virtual void notifyProgress( int _current ) = 0;
+    virtual ProgressPolicy getProgressPolicy() const { return ProgressPolicy(); }
+};
+
+// Interface that receives output of compress/decompress operations sequentially
+struct IOutputSink
+{
+    virtual ~IOutputSink() = default;
+    virtual bool write( const void * _data, std::size_t _size ) = 0;
+
+    // Seekable sink can overwrite already written bytes, _offset is relative to the
+    // first byte written to the sink. Compress streams output to seekable sinks
+    // and patches headers at the end, other sinks get output staged in memory.
+    virtual bool isSeekable() const { return false; }
+
+    // Hint of the total output size when it is known up front, sink may preallocate storage
+    virtual void reserve( std::size_t /*_totalSize*/ ) {}
+    virtual bool writeAt( std::size_t /*_offset*/, const void * /*_data*/, std::size_t /*_size*/ ) { return false; }
 };
 
 } // namespace PocketBook
\ No newline at end of file
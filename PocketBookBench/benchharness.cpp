@@ -0,0 +1,146 @@
+// Copyright PocketBook - Interview Task
+
+#include "benchharness.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define POCKETBOOK_HAS_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define POCKETBOOK_HAS_RDTSC
+#endif
+
+namespace PocketBook::Bench {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Single sample should be long enough for clock resolution and short enough to get several of them
+constexpr double MIN_SAMPLE_SECONDS = 0.01;
+constexpr std::size_t MIN_SAMPLES = 5;
+
+volatile std::uint64_t g_sink = 0;
+
+struct Sample
+{
+    double Seconds;
+    std::uint64_t Cycles;
+};
+
+Sample runSample(std::size_t _iterations, const std::function<void()> & _body)
+{
+    const auto start = Clock::now();
+    const std::uint64_t startCycles = readCycleCounter();
+    for(std::size_t i = 0; i < _iterations; ++i)
+        _body();
+    const std::uint64_t cycles = readCycleCounter() - startCycles;
+    return { std::chrono::duration<double>(Clock::now() - start).count(), cycles };
+}
+
+} // namespace
+
+BenchmarkRunner::BenchmarkRunner(double _minSeconds, std::string _filter)
+    : m_minSeconds(_minSeconds)
+    , m_filter(std::move(_filter))
+{
+}
+
+void BenchmarkRunner::run(const std::string & _name, std::size_t _bytes, std::size_t _pixels, const std::function<void()> & _body)
+{
+    if(!m_filter.empty() && _name.find(m_filter) == std::string::npos)
+        return;
+
+    // Warm up caches and lazily allocated buffers, then find iterations per sample
+    std::size_t iterations = 1;
+    Sample sample = runSample(iterations, _body);
+    while(sample.Seconds < MIN_SAMPLE_SECONDS)
+    {
+        iterations *= sample.Seconds > 0.0 ? std::min<std::size_t>(100, static_cast<std::size_t>(MIN_SAMPLE_SECONDS / sample.Seconds) + 1) : 100;
+        sample = runSample(iterations, _body);
+    }
+
+    std::vector<Sample> samples;
+    double totalSeconds = 0.0;
+    while(samples.size() < MIN_SAMPLES || totalSeconds < m_minSeconds)
+    {
+        samples.push_back(runSample(iterations, _body));
+        totalSeconds += samples.back().Seconds;
+    }
+
+    std::sort(samples.begin(), samples.end(), [](const Sample & _left, const Sample & _right)
+    {
+        return _left.Seconds < _right.Seconds;
+    });
+    const Sample & median = samples[samples.size() / 2];
+
+    BenchmarkResult result;
+    result.Name = _name;
+    result.Iterations = iterations * samples.size();
+    result.SecondsPerIteration = median.Seconds / iterations;
+    result.MegabytesPerSecond = _bytes / 1e6 / result.SecondsPerIteration;
+    if(_pixels)
+    {
+        result.NanosecondsPerPixel = result.SecondsPerIteration * 1e9 / _pixels;
+        result.CyclesPerPixel = static_cast<double>(median.Cycles) / iterations / _pixels;
+    }
+    m_results.push_back(result);
+}
+
+const std::vector<BenchmarkResult> & BenchmarkRunner::getResults() const
+{
+    return m_results;
+}
+
+void BenchmarkRunner::printHeader(std::ostream & _stream)
+{
+    char line[160];
+    snprintf(line, sizeof(line), "%-40s %12s %12s %10s %10s %10s\n", "benchmark", "iterations", "time, us", "MB/s", "ns/px", "cycles/px");
+    _stream << line << std::string(99, '-') << '\n';
+}
+
+void BenchmarkRunner::printResult(std::ostream & _stream, const BenchmarkResult & _result)
+{
+    char cycles[32] = "-";
+    if(hasCycleCounter())
+        snprintf(cycles, sizeof(cycles), "%.3f", _result.CyclesPerPixel);
+
+    char line[160];
+    snprintf(line, sizeof(line), "%-40s %12zu %12.1f %10.1f %10.3f %10s\n",
+        _result.Name.c_str(),
+        _result.Iterations,
+        _result.SecondsPerIteration * 1e6,
+        _result.MegabytesPerSecond,
+        _result.NanosecondsPerPixel,
+        cycles);
+    _stream << line;
+}
+
+std::uint64_t readCycleCounter()
+{
+#ifdef POCKETBOOK_HAS_RDTSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+bool hasCycleCounter()
+{
+#ifdef POCKETBOOK_HAS_RDTSC
+    return true;
+#else
+    return false;
+#endif
+}
+
+void doNotOptimize(std::uint64_t _value)
+{
+    g_sink = g_sink + _value;
+}
+
+} // namespace PocketBook::Bench
@@ -0,0 +1,54 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace PocketBook::Bench {
+
+struct BenchmarkResult
+{
+    std::string Name;
+    std::size_t Iterations = 0;
+    double SecondsPerIteration = 0.0;   // Median of samples
+    double MegabytesPerSecond = 0.0;
+    double NanosecondsPerPixel = 0.0;
+    double CyclesPerPixel = 0.0;        // 0 - cycle counter is not available
+};
+
+// Runs benchmark bodies repeatedly and collects their timings.
+// Each body is run in samples of several iterations until _minSeconds pass,
+// the median sample is reported, so a single preempted sample doesn't skew results.
+class BenchmarkRunner
+{
+public:
+    BenchmarkRunner(double _minSeconds, std::string _filter);
+
+    // _bytes and _pixels are processed by single call of _body, benchmarks not matching filter are skipped
+    void run(const std::string & _name, std::size_t _bytes, std::size_t _pixels, const std::function<void()> & _body);
+
+    const std::vector<BenchmarkResult> & getResults() const;
+
+    static void printHeader(std::ostream & _stream);
+    static void printResult(std::ostream & _stream, const BenchmarkResult & _result);
+
+private:
+    double m_minSeconds;
+    std::string m_filter;
+    std::vector<BenchmarkResult> m_results;
+};
+
+// Time stamp counter where the CPU provides one (x86 rdtsc), 0 otherwise.
+// TSC ticks at nominal frequency, so cycles are exact only with turbo and scaling disabled.
+std::uint64_t readCycleCounter();
+bool hasCycleCounter();
+
+// Keeps the value alive, so computation producing it isn't optimized away
+void doNotOptimize(std::uint64_t _value);
+
+} // namespace PocketBook::Bench
@@ -0,0 +1,388 @@
+// Copyright PocketBook - Interview Task
+
+#include "syntheticimage.h"
+#include "../BmpLib/bmpcodecformat.h"
+#include "../BmpLib/bmpexceptions.h"
+#include "../BmpLib/bmpproxy.h"
+#include "../BmpLib/bmprowindex.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using namespace PocketBook;
+using namespace PocketBook::Bench;
+
+using Clock = std::chrono::steady_clock;
+
+// Phases of bmp -> barch -> bmp round trip in the order they run
+enum Phase
+{
+    Map,    // createFromBmp: open and map input
+    Index,  // BmpRowIndex over mapped pixels, the first touch of input pages
+    Encode, // compress into memory
+    Write,  // compressed bytes to file
+    Open,   // createFromBarch: open, map and validate compressed file
+    Decode, // decompress into memory
+    PhaseCount
+};
+
+const char * const PHASE_NAMES[PhaseCount] = { "map", "index", "encode", "write", "open", "decode" };
+
+using PhaseTimes = std::array<double, PhaseCount>;
+
+struct BenchOptions
+{
+    std::vector<std::string> Inputs;
+    bool GeneratePages = false;
+    unsigned Repeat = 5;
+    unsigned CodecThreads = 1;
+    unsigned BlockWidth = 0; // Chosen by sampling, the bench measures the best format
+    RunLengthCoding RunLength = RunLengthCoding::Auto;
+    bool ShowHelp = false;
+};
+
+struct FileResult
+{
+    std::string Name;
+    std::uint64_t BmpBytes = 0;
+    std::uint64_t BarchBytes = 0;
+    PhaseTimes Seconds{};  // Median of repetitions
+    bool Exact = false;
+    std::string Error;
+};
+
+BenchOptions parseCommandLine(int _argc, char * _argv[])
+{
+    BenchOptions options;
+    for(int argIndex = 1; argIndex < _argc; ++argIndex)
+    {
+        const std::string arg = _argv[argIndex];
+        if(arg == "-h" || arg == "--help")
+            options.ShowHelp = true;
+        else if(arg == "--generate")
+            options.GeneratePages = true;
+        else if(arg == "--repeat" && argIndex + 1 < _argc)
+            options.Repeat = std::max(1, std::stoi(_argv[++argIndex]));
+        else if((arg == "-t" || arg == "--threads") && argIndex + 1 < _argc)
+            options.CodecThreads = static_cast<unsigned>(std::max(0, std::stoi(_argv[++argIndex])));
+        else if(arg == "--block-width" && argIndex + 1 < _argc)
+        {
+            options.BlockWidth = static_cast<unsigned>(std::max(0, std::stoi(_argv[++argIndex])));
+            if(!BmpCodecFormat::isValidBlockWidth(options.BlockWidth))
+                throw std::invalid_argument("Block width must be 4, 8 or 16");
+        }
+        else if(arg == "--run-length" && argIndex + 1 < _argc)
+        {
+            const std::string mode = _argv[++argIndex];
+            if(mode == "auto")
+                options.RunLength = RunLengthCoding::Auto;
+            else if(mode == "off")
+                options.RunLength = RunLengthCoding::Off;
+            else if(mode == "on")
+                options.RunLength = RunLengthCoding::On;
+            else
+                throw std::invalid_argument("Run length must be auto, off or on");
+        }
+        else if(!arg.empty() && arg[0] == '-')
+            throw std::invalid_argument("Unknown option: " + arg);
+        else
+            options.Inputs.push_back(arg);
+    }
+
+    if(!options.ShowHelp && options.Inputs.empty() && !options.GeneratePages)
+        throw std::invalid_argument("No corpus specified");
+
+    return options;
+}
+
+std::vector<std::uint8_t> readFile(const fs::path & _path)
+{
+    std::ifstream stream(_path, std::ios::binary);
+    if(!stream)
+        throw std::runtime_error("Unable to read " + _path.string());
+    return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const fs::path & _path, const std::vector<std::uint8_t> & _data)
+{
+    FILE * file = fopen(_path.string().c_str(), "wb");
+    if(!file)
+        throw std::runtime_error("Unable to create " + _path.string());
+
+    const bool written = fwrite(_data.data(), 1, _data.size(), file) == _data.size();
+    if(fclose(file) != 0 || !written)
+        throw std::runtime_error("Unable to write " + _path.string());
+}
+
+std::vector<fs::path> collectCorpus(const BenchOptions & _options, const fs::path & _workDirectory)
+{
+    std::vector<fs::path> corpus;
+    for(const auto & input : _options.Inputs)
+    {
+        if(fs::is_directory(input))
+        {
+            std::vector<fs::path> found;
+            for(const auto & entry : fs::directory_iterator(input))
+            {
+                if(entry.is_regular_file() && entry.path().extension() == ".bmp")
+                    found.push_back(entry.path());
+            }
+            std::sort(found.begin(), found.end());
+            corpus.insert(corpus.end(), found.begin(), found.end());
+        }
+        else
+        {
+            corpus.emplace_back(input);
+        }
+    }
+
+    // Generated scans are written to files, so they go through the same mapping as real ones
+    if(_options.GeneratePages)
+    {
+        for(const int dpi : { 300, 600 })
+        {
+            const fs::path page = _workDirectory / ("text-page-" + std::to_string(dpi) + "dpi.bmp");
+            writeFile(page, generateTextPageBmp(dpi));
+            corpus.push_back(page);
+        }
+
+        // Palette with white at index 0 must compress as well as the standard one
+        const fs::path reversed = _workDirectory / "text-page-300dpi-reversed.bmp";
+        writeFile(reversed, reversePalette(generateTextPageBmp(300)));
+        corpus.push_back(reversed);
+    }
+
+    return corpus;
+}
+
+FileResult runFile(const fs::path & _path, const fs::path & _workDirectory, const BenchOptions & _options)
+{
+    FileResult result;
+    result.Name = _path.filename().string();
+
+    const std::vector<std::uint8_t> original = readFile(_path);
+    const fs::path barchPath = _workDirectory / (_path.stem().string() + ".barch");
+
+    CodecOptions codecOptions;
+    codecOptions.ThreadCount = _options.CodecThreads;
+    codecOptions.BlockWidth = _options.BlockWidth;
+    codecOptions.RunLength = _options.RunLength;
+
+    std::vector<PhaseTimes> runs;
+    std::vector<std::uint8_t> compressed;
+    std::vector<std::uint8_t> decoded;
+    for(unsigned run = 0; run < _options.Repeat; ++run)
+    {
+        PhaseTimes times{};
+        auto last = Clock::now();
+        auto finishPhase = [&](Phase _phase)
+        {
+            const auto now = Clock::now();
+            times[_phase] = std::chrono::duration<double>(now - last).count();
+            last = now;
+        };
+
+        auto bmpImage = BmpProxy::createFromBmp(_path.string());
+        finishPhase(Map);
+
+        RawImageData raw;
+        if(!bmpImage.provideRawImageData(raw))
+            throw std::runtime_error("Not an uncompressed bmp file");
+        const BmpRowIndex rowIndex = BmpRowIndex::createFromRawImageData(raw);
+        finishPhase(Index);
+
+        if(!bmpImage.compress(compressed, nullptr, codecOptions))
+            throw std::runtime_error("Unable to compress file");
+        finishPhase(Encode);
+
+        writeFile(barchPath, compressed);
+        finishPhase(Write);
+
+        auto barchImage = BmpProxy::createFromBarch(barchPath.string());
+        finishPhase(Open);
+
+        if(!barchImage.decompress(decoded, nullptr, codecOptions))
+            throw std::runtime_error("Unable to decompress file");
+        finishPhase(Decode);
+
+        runs.push_back(times);
+    }
+
+    for(std::size_t phase = 0; phase < PhaseCount; ++phase)
+    {
+        std::vector<double> samples;
+        for(const auto & times : runs)
+            samples.push_back(times[phase]);
+        std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+        result.Seconds[phase] = samples[samples.size() / 2];
+    }
+
+    result.BmpBytes = original.size();
+    result.BarchBytes = compressed.size();
+    result.Exact = decoded == original;
+    fs::remove(barchPath);
+    return result;
+}
+
+// Empty file and file cut after the bmp header, which claims exactly its own size, must be
+// rejected by every read strategy before any header is read
+bool rejectsTruncatedFiles(const fs::path & _workDirectory)
+{
+    std::vector<std::uint8_t> header = generateTextPageBmp(300);
+    header.resize(18);
+    header[2] = 18;
+    header[3] = header[4] = header[5] = 0;
+
+    const std::vector<std::pair<std::string, std::vector<std::uint8_t>>> files = {
+        { "empty.bmp", {} },
+        { "truncated.bmp", header },
+    };
+
+    bool rejected = true;
+    for(const auto & [name, data] : files)
+    {
+        const fs::path path = _workDirectory / name;
+        writeFile(path, data);
+
+        for(const ReadStrategy strategy : { ReadStrategy::Read, ReadStrategy::ReadHugePages, ReadStrategy::Map })
+        {
+            ReadOptions readOptions;
+            readOptions.Strategy = strategy;
+            for(const bool compressed : { false, true })
+            {
+                try
+                {
+                    if(compressed)
+                        BmpProxy::createFromBarch(path.string(), readOptions);
+                    else
+                        BmpProxy::createFromBmp(path.string(), readOptions);
+                    printf("%s is accepted\n", name.c_str());
+                    rejected = false;
+                }
+                catch( const FileError & )
+                {
+                }
+            }
+        }
+        fs::remove(path);
+    }
+
+    return rejected;
+}
+
+void printHeader()
+{
+    printf("%-28s %9s %7s", "file", "MB", "ratio");
+    for(const char * name : PHASE_NAMES)
+        printf(" %8s", name);
+    printf(" %9s %9s  %s\n", "enc MB/s", "dec MB/s", "round trip");
+    printf("%s\n", std::string(28 + 10 + 8 + PhaseCount * 9 + 20 + 12, '-').c_str());
+}
+
+void printRow(const std::string & _name, std::uint64_t _bmpBytes, std::uint64_t _barchBytes, const PhaseTimes & _seconds, const char * _status)
+{
+    const double megabytes = _bmpBytes / 1e6;
+    printf("%-28s %9.2f %7.2f", _name.c_str(), megabytes, _barchBytes ? static_cast<double>(_bmpBytes) / _barchBytes : 0.0);
+    for(const double seconds : _seconds)
+        printf(" %8.2f", seconds * 1e3);
+    printf(" %9.1f %9.1f  %s\n",
+        _seconds[Encode] > 0.0 ? megabytes / _seconds[Encode] : 0.0,
+        _seconds[Decode] > 0.0 ? megabytes / _seconds[Decode] : 0.0,
+        _status);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+    try
+    {
+        options = parseCommandLine(argc, argv);
+    }
+    catch( const std::exception & _err )
+    {
+        std::cerr << "pocketbook-corpusbench: " << _err.what() << "\n";
+        return 2;
+    }
+
+    if(options.ShowHelp)
+    {
+        std::cout << "Usage: pocketbook-corpusbench [--generate] [--repeat <count>] [-t <threads>] [--block-width <4|8|16>] [--run-length <auto|off|on>] <file|directory>...\n"
+                     "Round trips each bmp through compress and decompress, reports median time of each phase in ms.\n"
+                     "  --generate  Add generated A4 text pages scanned at 300 and 600 dpi to the corpus,\n"
+                     "              and 300 dpi page with reversed palette.\n"
+                     "  --block-width  Compress with the given block width instead of choosing it per file.\n"
+                     "  --run-length   Force run length coding of white and black blocks on or off.\n";
+        return 0;
+    }
+
+    const fs::path workDirectory = fs::temp_directory_path() / "pocketbook-corpusbench";
+    fs::create_directories(workDirectory);
+
+    bool allExact = true;
+    try
+    {
+        const std::vector<fs::path> corpus = collectCorpus(options, workDirectory);
+
+        printf("Repetitions: %u, codec threads: %u, times in ms\n\n", options.Repeat, options.CodecThreads);
+        printHeader();
+
+        FileResult total;
+        for(const auto & path : corpus)
+        {
+            FileResult result;
+            try
+            {
+                result = runFile(path, workDirectory, options);
+            }
+            catch( const std::exception & _err )
+            {
+                result.Name = path.filename().string();
+                result.Error = _err.what();
+            }
+
+            if(!result.Error.empty())
+            {
+                allExact = false;
+                printf("%-28s %s\n", result.Name.c_str(), result.Error.c_str());
+                continue;
+            }
+
+            allExact = allExact && result.Exact;
+            printRow(result.Name, result.BmpBytes, result.BarchBytes, result.Seconds, result.Exact ? "exact" : "MISMATCH");
+
+            total.BmpBytes += result.BmpBytes;
+            total.BarchBytes += result.BarchBytes;
+            for(std::size_t phase = 0; phase < PhaseCount; ++phase)
+                total.Seconds[phase] += result.Seconds[phase];
+        }
+
+        printRow("total", total.BmpBytes, total.BarchBytes, total.Seconds, allExact ? "exact" : "FAILED");
+
+        const bool rejected = rejectsTruncatedFiles(workDirectory);
+        printf("\nTruncated files: %s\n", rejected ? "rejected" : "FAILED");
+        allExact = allExact && rejected;
+    }
+    catch( const std::exception & _err )
+    {
+        std::cerr << "pocketbook-corpusbench: " << _err.what() << "\n";
+        allExact = false;
+    }
+
+    std::error_code error;
+    fs::remove_all(workDirectory, error);
+    return allExact ? 0 : 1;
+}
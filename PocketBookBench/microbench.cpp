@@ -0,0 +1,227 @@
+// Copyright PocketBook - Interview Task
+
+#include "benchharness.h"
+#include "syntheticimage.h"
+#include "../BmpLib/bitreader.h"
+#include "../BmpLib/bitwriter.h"
+#include "../BmpLib/bmpcodec.h"
+#include "../BmpLib/bmpcodecformat.h"
+#include "../BmpLib/bmpkernels.h"
+#include "../BmpLib/bmprowindex.h"
+#include "../BmpLib/dynamicbitset.h"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+using namespace PocketBook;
+using namespace PocketBook::Bench;
+
+constexpr std::size_t BITSET_BITS = std::size_t(1) << 23;
+
+// Sizes cover scanned pages at 300 and 600 dpi and small images where per-row overhead dominates,
+// odd width exercises row padding
+const SyntheticImageSpec IMAGE_SPECS[] = {
+    { "page300-text",  2480, 3508, 0.55, 0.04, 0.02 },
+    { "page600-text",  4960, 7016, 0.55, 0.04, 0.02 },
+    { "page300-blank", 2480, 3508, 1.00, 0.00, 0.00 },
+    { "mixed-odd",     1021,  768, 0.30, 0.30, 0.30 },
+    { "dense-literal", 1024, 1024, 0.00, 0.10, 0.85 },
+    { "small",          160,  120, 0.30, 0.30, 0.20 },
+};
+
+struct BenchOptions
+{
+    double MinSeconds = 0.5;
+    std::string Filter;
+    bool ShowHelp = false;
+};
+
+BenchOptions parseCommandLine(int _argc, char * _argv[])
+{
+    BenchOptions options;
+    for(int argIndex = 1; argIndex < _argc; ++argIndex)
+    {
+        const std::string arg = _argv[argIndex];
+        if(arg == "-h" || arg == "--help")
+            options.ShowHelp = true;
+        else if(arg == "--filter" && argIndex + 1 < _argc)
+            options.Filter = _argv[++argIndex];
+        else if(arg == "--min-time" && argIndex + 1 < _argc)
+            options.MinSeconds = std::stod(_argv[++argIndex]);
+        else
+            throw std::invalid_argument("Unknown option: " + arg);
+    }
+    return options;
+}
+
+// Cheap deterministic bit pattern without branch predictable period
+bool getPatternBit(std::size_t _index)
+{
+    return (_index * 0x9E3779B97F4A7C15ull) >> 63;
+}
+
+void addBitsetBenchmarks(BenchmarkRunner & _runner)
+{
+    DynamicBitset bitset(DynamicBitset::getNumBlocksRequired(BITSET_BITS), 0x00);
+
+    _runner.run("bitset/set", BITSET_BITS / 8, BITSET_BITS, [&]
+    {
+        for(std::size_t bit = 0; bit < BITSET_BITS; ++bit)
+            bitset.set(bit, getPatternBit(bit));
+        doNotOptimize(bitset.getBlockValue(0));
+    });
+
+    _runner.run("bitset/test", BITSET_BITS / 8, BITSET_BITS, [&]
+    {
+        std::uint64_t setBits = 0;
+        for(std::size_t bit = 0; bit < BITSET_BITS; ++bit)
+            setBits += bitset.test(bit);
+        doNotOptimize(setBits);
+    });
+}
+
+// Mirrors per-row work of BmpProxy::compress/decompress without file and progress overhead
+bool addCodecBenchmarks(BenchmarkRunner & _runner, const SyntheticImageSpec & _spec, const RawImageData & _raw, const BmpCodecFormat & _format, const std::string & _suffix)
+{
+    const std::size_t padding = _raw.getPadding();
+    const std::size_t rowSize = _raw.getActualWidth();
+    const std::size_t blocksPerRow = rowSize / sizeof(std::uint32_t);
+    const std::size_t height = _raw.Height;
+    const std::size_t imageBytes = rowSize * height;
+    const std::size_t pixels = static_cast<std::size_t>(_raw.Width) * height;
+
+    _runner.run("encode" + _suffix + "/" + _spec.Name, imageBytes, pixels, [&]
+    {
+        BitWriter writer(imageBytes / 4);
+        for(std::size_t rowIndex = 0; rowIndex < height; ++rowIndex)
+        {
+            const auto * row = _raw.Data + rowIndex * rowSize;
+            if(!Kernels::isWhiteRow(row, _raw.Width, padding, WHITE_PIXEL))
+                Codec::encodeRow(row, blocksPerRow, _format, writer);
+        }
+        writer.flush();
+        doNotOptimize(writer.numBytes());
+    });
+
+    // Decoder input is produced once by the same loop
+    std::vector<bool> whiteRows(height);
+    BitWriter writer(imageBytes / 4);
+    for(std::size_t rowIndex = 0; rowIndex < height; ++rowIndex)
+    {
+        const auto * row = _raw.Data + rowIndex * rowSize;
+        whiteRows[rowIndex] = Kernels::isWhiteRow(row, _raw.Width, padding, WHITE_PIXEL);
+        if(!whiteRows[rowIndex])
+            Codec::encodeRow(row, blocksPerRow, _format, writer);
+    }
+    writer.flush();
+    const std::vector<std::uint8_t> encoded = writer.release();
+
+    const auto whiteRowPattern = BmpRowIndex::getWhiteRowPattern(_raw.Width);
+    std::vector<std::uint8_t> decoded(imageBytes);
+    auto decode = [&]
+    {
+        BitReader reader(encoded.data(), encoded.size());
+        for(std::size_t rowIndex = 0; rowIndex < height; ++rowIndex)
+        {
+            std::uint8_t * row = decoded.data() + rowIndex * rowSize;
+            if(whiteRows[rowIndex])
+                memcpy(row, whiteRowPattern.data(), whiteRowPattern.size());
+            else
+                Codec::decodeRow(reader, row, blocksPerRow, _format);
+        }
+        doNotOptimize(decoded[0]);
+    };
+
+    decode();
+    if(memcmp(decoded.data(), _raw.Data, imageBytes) != 0)
+    {
+        std::cerr << "Round trip mismatch on " << _spec.Name << _suffix << "\n";
+        return false;
+    }
+
+    _runner.run("decode" + _suffix + "/" + _spec.Name, imageBytes, pixels, decode);
+    return true;
+}
+
+bool addImageBenchmarks(BenchmarkRunner & _runner, const SyntheticImageSpec & _spec)
+{
+    const std::vector<std::uint8_t> file = generateBmp(_spec);
+    const RawImageData raw = getRawImageData(file);
+
+    const std::size_t imageBytes = raw.getActualWidth() * raw.Height;
+    const std::size_t pixels = static_cast<std::size_t>(raw.Width) * raw.Height;
+
+    _runner.run("rowindex/" + _spec.Name, imageBytes, pixels, [&]
+    {
+        const BmpRowIndex index = BmpRowIndex::createFromRawImageData(raw);
+        doNotOptimize(index.getData()[0]);
+    });
+
+    // Default format keeps the original benchmark names, others are suffixed by width and run length coding
+    for(const bool runLength : { false, true })
+    {
+        for(const unsigned blockWidth : { 4u, 8u, 16u })
+        {
+            const BmpCodecFormat format = BmpCodecFormat().withBlockWidth(blockWidth).withRunLength(runLength);
+            std::string suffix = blockWidth == BmpCodecFormat::DEFAULT_BLOCK_WIDTH ? "" : "-w" + std::to_string(blockWidth);
+            if(runLength)
+                suffix += "-rle";
+            if(!addCodecBenchmarks(_runner, _spec, raw, format, suffix))
+                return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+    try
+    {
+        options = parseCommandLine(argc, argv);
+    }
+    catch( const std::exception & _err )
+    {
+        std::cerr << "pocketbook-microbench: " << _err.what() << "\n";
+        return 2;
+    }
+
+    if(options.ShowHelp)
+    {
+        std::cout << "Usage: pocketbook-microbench [--filter <text>] [--min-time <seconds>]\n"
+                     "Runs BmpLib kernels over synthetic images, only benchmarks containing <text> are run.\n";
+        return 0;
+    }
+
+    std::cout << "SIMD level: " << Kernels::getSimdLevelName(Kernels::getSimdLevel()) << "\n"
+              << "Cycles: " << (hasCycleCounter() ? "time stamp counter" : "not available")
+              << ", bitset benchmarks count bits as pixels\n\n";
+
+    BenchmarkRunner runner(options.MinSeconds, options.Filter);
+    BenchmarkRunner::printHeader(std::cout);
+
+    std::size_t printed = 0;
+    auto printNewResults = [&]
+    {
+        for(; printed < runner.getResults().size(); ++printed)
+            BenchmarkRunner::printResult(std::cout, runner.getResults()[printed]);
+        std::cout.flush();
+    };
+
+    addBitsetBenchmarks(runner);
+    printNewResults();
+
+    for(const auto & spec : IMAGE_SPECS)
+    {
+        if(!addImageBenchmarks(runner, spec))
+            return 1;
+        printNewResults();
+    }
+
+    return 0;
+}
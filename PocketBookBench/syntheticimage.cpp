@@ -0,0 +1,227 @@
+// Copyright PocketBook - Interview Task
+
+#include "syntheticimage.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+
+namespace PocketBook::Bench {
+
+namespace {
+
+constexpr std::size_t PALETTE_SIZE = 256 * 4;
+constexpr std::uint32_t PIXELS_PER_METER_300_DPI = 11811;
+constexpr double A4_WIDTH_INCHES = 8.27;
+constexpr double A4_HEIGHT_INCHES = 11.69;
+constexpr std::uint8_t EDGE_GRAY_PIXEL = 0xA0;
+
+void writeLiteralBlock(std::uint8_t * _block, std::mt19937_64 & _random)
+{
+    const std::uint32_t pixels = static_cast<std::uint32_t>(_random());
+    memcpy(_block, &pixels, sizeof(pixels));
+
+    // Literal must not collide with white or black block codes
+    if(pixels == WHITE_4PIXELS || pixels == BLACK_4PIXELS)
+        _block[0] = 0x80;
+}
+
+// White image with zero row padding and grayscale palette
+std::vector<std::uint8_t> createWhiteBmp(int _width, int _height, std::uint32_t _pixelsPerMeter)
+{
+    if(_width <= 0 || _height <= 0)
+        throw std::invalid_argument("Synthetic image must not be empty");
+
+    const std::size_t padding = RawImageData::calculatePadding(_width);
+    const std::size_t rowSize = _width + padding;
+    const std::size_t imageSize = rowSize * _height;
+    const std::size_t dataOffset = sizeof(BmpHeader) + sizeof(BmpInfoHeader) + PALETTE_SIZE;
+
+    BmpHeader header{};
+    header.Signature = UNCOMPRESSED_SIGNATURE;
+    header.FileSize = static_cast<std::uint32_t>(dataOffset + imageSize);
+    header.DataOffset = static_cast<std::uint32_t>(dataOffset);
+
+    BmpInfoHeader infoHeader{};
+    infoHeader.Size = sizeof(BmpInfoHeader);
+    infoHeader.Width = _width;
+    infoHeader.Height = _height;
+    infoHeader.Planes = 1;
+    infoHeader.BitsPerPixel = 8;
+    infoHeader.ImageSize = static_cast<std::uint32_t>(imageSize);
+    infoHeader.XpixelsPerM = _pixelsPerMeter;
+    infoHeader.YpixelsPerM = _pixelsPerMeter;
+    infoHeader.ColorsUsed = 256;
+    infoHeader.NumImportantColors = 256;
+
+    std::vector<std::uint8_t> file(header.FileSize, 0x00);
+    memcpy(file.data(), &header, sizeof(header));
+    memcpy(file.data() + INFO_HEADER_OFFSET, &infoHeader, sizeof(infoHeader));
+
+    std::uint8_t * palette = file.data() + sizeof(BmpHeader) + sizeof(BmpInfoHeader);
+    for(std::size_t color = 0; color < 256; ++color)
+        memset(palette + color * 4, static_cast<int>(color), 3);
+
+    std::uint8_t * row = file.data() + dataOffset;
+    for(int rowIndex = 0; rowIndex < _height; ++rowIndex, row += rowSize)
+        memset(row, WHITE_PIXEL, _width);
+
+    return file;
+}
+
+std::uint8_t * getPixelData(std::vector<std::uint8_t> & _bmpFile)
+{
+    BmpHeader header;
+    memcpy(&header, _bmpFile.data(), sizeof(header));
+    return _bmpFile.data() + header.DataOffset;
+}
+
+} // namespace
+
+std::vector<std::uint8_t> generateBmp(const SyntheticImageSpec & _spec, std::uint64_t _seed)
+{
+    std::vector<std::uint8_t> file = createWhiteBmp(_spec.Width, _spec.Height, PIXELS_PER_METER_300_DPI);
+    const RawImageData raw = getRawImageData(file);
+    const std::size_t rowSize = raw.getActualWidth();
+
+    std::mt19937_64 random(_seed);
+    std::uniform_real_distribution<double> probability(0.0, 1.0);
+
+    // Trailing pixels of a row that don't form full block are white like in scanned pages
+    std::uint8_t * row = getPixelData(file);
+    for(int rowIndex = 0; rowIndex < _spec.Height; ++rowIndex, row += rowSize)
+    {
+        if(probability(random) < _spec.WhiteRowRatio)
+            continue;
+
+        for(std::size_t block = 0; block + 4 <= static_cast<std::size_t>(_spec.Width); block += 4)
+        {
+            const double kind = probability(random);
+            if(kind < _spec.BlackBlockRatio)
+                memset(row + block, BLACK_PIXEL, 4);
+            else if(kind < _spec.BlackBlockRatio + _spec.LiteralBlockRatio)
+                writeLiteralBlock(row + block, random);
+        }
+    }
+
+    return file;
+}
+
+std::vector<std::uint8_t> generateTextPageBmp(int _dpi, std::uint64_t _seed)
+{
+    if(_dpi <= 0)
+        throw std::invalid_argument("Page resolution must be positive");
+
+    const int width = static_cast<int>(A4_WIDTH_INCHES * _dpi);
+    const int height = static_cast<int>(A4_HEIGHT_INCHES * _dpi);
+    std::vector<std::uint8_t> file = createWhiteBmp(width, height, static_cast<std::uint32_t>(_dpi / 0.0254 + 0.5));
+    const RawImageData raw = getRawImageData(file);
+    const std::size_t rowSize = raw.getActualWidth();
+    std::uint8_t * pixels = getPixelData(file);
+
+    // Page coordinates are top-down, bmp rows are stored bottom-up
+    auto fillRect = [&](int _x, int _y, int _width, int _height, std::uint8_t _color, bool _onlyWhite)
+    {
+        for(int y = std::max(_y, 0); y < std::min(_y + _height, height); ++y)
+        {
+            std::uint8_t * row = pixels + static_cast<std::size_t>(height - 1 - y) * rowSize;
+            for(int x = std::max(_x, 0); x < std::min(_x + _width, width); ++x)
+            {
+                if(!_onlyWhite || row[x] == WHITE_PIXEL)
+                    row[x] = _color;
+            }
+        }
+    };
+
+    // Stroke with one pixel of gray edge around it, as scanner blurs glyph contours
+    auto drawStroke = [&](int _x, int _y, int _width, int _height)
+    {
+        fillRect(_x - 1, _y - 1, _width + 2, _height + 2, EDGE_GRAY_PIXEL, true);
+        fillRect(_x, _y, _width, _height, BLACK_PIXEL, false);
+    };
+
+    std::mt19937_64 random(_seed);
+    auto uniform = [&](int _min, int _max)
+    {
+        return std::uniform_int_distribution<int>(_min, _max)(random);
+    };
+
+    // 12 pt text with 1 inch margins
+    const int margin = _dpi;
+    const int lineHeight = _dpi / 6;
+    const int glyphHeight = lineHeight / 2;
+    const int stroke = std::max(1, _dpi / 100);
+
+    for(int lineTop = margin; lineTop + lineHeight <= height - margin; lineTop += lineHeight)
+    {
+        // Empty lines between paragraphs
+        if(uniform(0, 9) == 0)
+            continue;
+
+        const int lineEnd = margin + (width - 2 * margin) * uniform(60, 100) / 100;
+        const int baseline = lineTop + lineHeight * 3 / 4;
+        int x = margin;
+        while(x < lineEnd)
+        {
+            const int wordGlyphs = uniform(2, 9);
+            for(int glyph = 0; glyph < wordGlyphs && x < lineEnd; ++glyph)
+            {
+                const int glyphWidth = glyphHeight * uniform(35, 60) / 100;
+                const int top = baseline - (uniform(0, 3) == 0 ? glyphHeight * 3 / 2 : glyphHeight);
+
+                // Glyph is a random combination of stems and bars
+                const int shape = uniform(1, 15);
+                if(shape & 1)
+                    drawStroke(x, top, stroke, baseline - top);
+                if(shape & 2)
+                    drawStroke(x + glyphWidth - stroke, baseline - glyphHeight, stroke, glyphHeight);
+                if(shape & 4)
+                    drawStroke(x, baseline - glyphHeight, glyphWidth, stroke);
+                if(shape & 8)
+                    drawStroke(x, baseline - stroke, glyphWidth, stroke);
+
+                x += glyphWidth + glyphHeight / 8;
+            }
+            x += glyphHeight / 3;
+        }
+    }
+
+    return file;
+}
+
+std::vector<std::uint8_t> reversePalette(const std::vector<std::uint8_t> & _bmpFile)
+{
+    std::vector<std::uint8_t> file = _bmpFile;
+    const RawImageData raw = getRawImageData(file);
+
+    std::uint8_t * palette = file.data() + sizeof(BmpHeader) + sizeof(BmpInfoHeader);
+    for(std::size_t color = 0; color < 128; ++color)
+        std::swap_ranges(palette + color * 4, palette + color * 4 + 4, palette + (255 - color) * 4);
+
+    // Row padding stays zero
+    std::uint8_t * row = getPixelData(file);
+    for(int rowIndex = 0; rowIndex < raw.Height; ++rowIndex, row += raw.getActualWidth())
+    {
+        for(int x = 0; x < raw.Width; ++x)
+            row[x] = static_cast<std::uint8_t>(255 - row[x]);
+    }
+
+    return file;
+}
+
+RawImageData getRawImageData(const std::vector<std::uint8_t> & _bmpFile)
+{
+    BmpHeader header;
+    BmpInfoHeader infoHeader;
+    memcpy(&header, _bmpFile.data(), sizeof(header));
+    memcpy(&infoHeader, _bmpFile.data() + INFO_HEADER_OFFSET, sizeof(infoHeader));
+
+    RawImageData raw;
+    raw.Width = static_cast<int>(infoHeader.Width);
+    raw.Height = static_cast<int>(infoHeader.Height);
+    raw.Data = _bmpFile.data() + header.DataOffset;
+    return raw;
+}
+
+} // namespace PocketBook::Bench
@@ -0,0 +1,39 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include "../BmpLib/bmpdefs.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PocketBook::Bench {
+
+// Random 8bit grayscale image. Rows are white with WhiteRowRatio probability,
+// each 4 pixel block of other rows is black, literal (random pixels) or white.
+struct SyntheticImageSpec
+{
+    std::string Name;
+    int Width = 0;
+    int Height = 0;
+    double WhiteRowRatio = 0.0;
+    double BlackBlockRatio = 0.0;
+    double LiteralBlockRatio = 0.0;
+};
+
+// Returns complete bmp file with grayscale palette, the same seed gives the same image
+std::vector<std::uint8_t> generateBmp(const SyntheticImageSpec & _spec, std::uint64_t _seed = 1);
+
+// Scan of A4 page with lines of text at _dpi: white margins and line gaps, black glyph strokes
+// with gray anti-aliased edges, so it has all row and block kinds in proportions of real documents
+std::vector<std::uint8_t> generateTextPageBmp(int _dpi, std::uint64_t _seed = 1);
+
+// The same picture with reversed palette: color of index i is moved to 255 - i and pixels are remapped,
+// so white and black are no longer at their default indices
+std::vector<std::uint8_t> reversePalette(const std::vector<std::uint8_t> & _bmpFile);
+
+// Pixel data of bmp file produced by functions above, the file must outlive returned data
+RawImageData getRawImageData(const std::vector<std::uint8_t> & _bmpFile);
+
+} // namespace PocketBook::Bench
@@ -0,0 +1,151 @@
+// Copyright PocketBook - Interview Task
+
+#include "batchreport.h"
+
+#include <cstdio>
+
+namespace PocketBook::Cli {
+
+namespace {
+
+std::string escapeJson(const std::string & _text)
+{
+    std::string escaped;
+    escaped.reserve(_text.size() + 2);
+    escaped += '"';
+    for(const char c : _text)
+    {
+        switch(c)
+        {
+        case '"':  escaped += "\\\""; break;
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\r': escaped += "\\r"; break;
+        case '\t': escaped += "\\t"; break;
+        default:
+            if(static_cast<unsigned char>(c) < 0x20)
+            {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned>(c));
+                escaped += code;
+            }
+            else
+            {
+                escaped += c;
+            }
+        }
+    }
+    escaped += '"';
+    return escaped;
+}
+
+std::string formatNumber(double _value)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%.6g", _value);
+    return text;
+}
+
+struct Metrics
+{
+    std::uint64_t BmpBytes = 0;
+    std::uint64_t BarchBytes = 0;
+    double Seconds = 0.0;
+
+    double getThroughput() const
+    {
+        return Seconds > 0.0 ? BmpBytes / 1e6 / Seconds : 0.0;
+    }
+
+    double getCompressionRatio() const
+    {
+        return BarchBytes > 0 ? static_cast<double>(BmpBytes) / BarchBytes : 0.0;
+    }
+};
+
+Metrics getMetrics(const FileReport & _file)
+{
+    Metrics metrics;
+    if(!_file.Result.Succeeded)
+        return metrics;
+
+    metrics.BmpBytes = _file.Job.Compress ? _file.InputBytes : _file.OutputBytes;
+    metrics.BarchBytes = _file.Job.Compress ? _file.OutputBytes : _file.InputBytes;
+    metrics.Seconds = _file.Seconds;
+    return metrics;
+}
+
+void writeMetrics(std::ostream & _stream, const Metrics & _metrics, const char * _indent)
+{
+    _stream << _indent << "\"seconds\": " << formatNumber(_metrics.Seconds) << ",\n"
+            << _indent << "\"throughputMBps\": " << formatNumber(_metrics.getThroughput()) << ",\n"
+            << _indent << "\"compressionRatio\": " << formatNumber(_metrics.getCompressionRatio()) << "\n";
+}
+
+void writeStatistics(std::ostream & _stream, const OperationStatistics & _statistics, const char * _indent)
+{
+    _stream << _indent << "\"statistics\": {\n"
+            << _indent << "  \"codecSeconds\": " << formatNumber(_statistics.CodecSeconds) << ",\n"
+            << _indent << "  \"writeSeconds\": " << formatNumber(_statistics.WriteSeconds) << ",\n"
+            << _indent << "  \"blockWidth\": " << _statistics.BlockWidth << ",\n"
+            << _indent << "  \"runLength\": " << (_statistics.RunLength ? "true" : "false") << ",\n"
+            << _indent << "  \"rows\": " << _statistics.Rows << ",\n"
+            << _indent << "  \"whiteRows\": " << _statistics.WhiteRows << ",\n"
+            << _indent << "  \"whiteBlocks\": " << _statistics.WhiteBlocks << ",\n"
+            << _indent << "  \"blackBlocks\": " << _statistics.BlackBlocks << ",\n"
+            << _indent << "  \"literalBlocks\": " << _statistics.LiteralBlocks << ",\n"
+            << _indent << "  \"peakBufferBytes\": " << _statistics.PeakBufferBytes << "\n"
+            << _indent << "},\n";
+}
+
+} // namespace
+
+void writeJsonReport(std::ostream & _stream, const BatchReport & _report)
+{
+    _stream << "{\n"
+            << "  \"backend\": " << escapeJson(_report.Backend) << ",\n"
+            << "  \"workers\": " << _report.Workers << ",\n"
+            << "  \"codecThreads\": " << _report.CodecThreads << ",\n"
+            << "  \"files\": [";
+
+    Metrics total;
+    std::size_t failed = 0;
+    for(std::size_t i = 0; i < _report.Files.size(); ++i)
+    {
+        const FileReport & file = _report.Files[i];
+        const Metrics metrics = getMetrics(file);
+        total.BmpBytes += metrics.BmpBytes;
+        total.BarchBytes += metrics.BarchBytes;
+        if(!file.Result.Succeeded)
+            ++failed;
+
+        _stream << (i ? ",\n" : "\n")
+                << "    {\n"
+                << "      \"input\": " << escapeJson(file.Job.InputPath) << ",\n"
+                << "      \"output\": " << escapeJson(file.Job.OutputPath) << ",\n"
+                << "      \"operation\": " << (file.Job.Compress ? "\"compress\"" : "\"decompress\"") << ",\n"
+                << "      \"succeeded\": " << (file.Result.Succeeded ? "true" : "false") << ",\n";
+        if(!file.Result.Succeeded)
+            _stream << "      \"error\": " << escapeJson(file.Result.ErrorMessage) << ",\n";
+        _stream << "      \"inputBytes\": " << file.InputBytes << ",\n"
+                << "      \"outputBytes\": " << file.OutputBytes << ",\n";
+        if(file.Result.Succeeded)
+            writeStatistics(_stream, file.Result.Statistics, "      ");
+        writeMetrics(_stream, metrics, "      ");
+        _stream << "    }";
+    }
+
+    // Summary throughput is based on wall time, so it includes parallel speedup
+    total.Seconds = _report.Seconds;
+    _stream << (_report.Files.empty() ? "],\n" : "\n  ],\n")
+            << "  \"summary\": {\n"
+            << "    \"files\": " << _report.Files.size() << ",\n"
+            << "    \"failed\": " << failed << ",\n"
+            << "    \"bmpBytes\": " << total.BmpBytes << ",\n"
+            << "    \"barchBytes\": " << total.BarchBytes << ",\n";
+    writeMetrics(_stream, total, "    ");
+    _stream << "  }\n"
+            << "}\n";
+}
+
+} // namespace PocketBook::Cli
@@ -0,0 +1,38 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include "../BmpLib/bmpbatch.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace PocketBook::Cli {
+
+struct FileReport
+{
+    BatchJob Job;
+    BatchJobResult Result;
+    std::uint64_t InputBytes = 0;
+    std::uint64_t OutputBytes = 0;
+    double Seconds = 0.0;
+};
+
+struct BatchReport
+{
+    std::string Backend;
+    unsigned Workers = 0;
+    unsigned CodecThreads = 0;
+    double Seconds = 0.0; // Wall time of the whole batch
+    std::vector<FileReport> Files;
+};
+
+// Writes report as JSON object with "files" array and "summary".
+// Throughput is measured in MB/s of uncompressed bmp data, compression ratio
+// is bmp size divided by barch size for both operations. Succeeded files also
+// have "statistics" object with codec time and row and block counts.
+void writeJsonReport(std::ostream & _stream, const BatchReport & _report);
+
+} // namespace PocketBook::Cli
@@ -0,0 +1,125 @@
+// Copyright PocketBook - Interview Task
+
+#include "clioptions.h"
+#include "../BmpLib/bmpcodecformat.h"
+
+#include <stdexcept>
+
+namespace PocketBook::Cli {
+
+namespace {
+
+unsigned parseCount(const std::string & _option, const std::string & _value)
+{
+    try
+    {
+        std::size_t parsed = 0;
+        const long value = std::stol(_value, &parsed);
+        if(parsed == _value.size() && value >= 0)
+            return static_cast<unsigned>(value);
+    }
+    catch( const std::exception & )
+    {
+    }
+
+    throw std::invalid_argument("Invalid value of " + _option + ": " + _value);
+}
+
+unsigned parseBlockWidth(const std::string & _option, const std::string & _value)
+{
+    const unsigned blockWidth = parseCount(_option, _value);
+    if(blockWidth && !BmpCodecFormat::isValidBlockWidth(blockWidth))
+        throw std::invalid_argument("Invalid value of " + _option + ": " + _value);
+    return blockWidth;
+}
+
+RunLengthCoding parseRunLength(const std::string & _option, const std::string & _value)
+{
+    if(_value == "auto")
+        return RunLengthCoding::Auto;
+    if(_value == "off")
+        return RunLengthCoding::Off;
+    if(_value == "on")
+        return RunLengthCoding::On;
+
+    throw std::invalid_argument("Invalid value of " + _option + ": " + _value);
+}
+
+} // namespace
+
+CliOptions parseCommandLine(int _argc, const char * const * _argv)
+{
+    CliOptions options;
+
+    for(int argIndex = 1; argIndex < _argc; ++argIndex)
+    {
+        const std::string arg = _argv[argIndex];
+
+        auto takeValue = [&]() -> std::string
+        {
+            if(argIndex + 1 >= _argc)
+                throw std::invalid_argument("Missing value of " + arg);
+            return _argv[++argIndex];
+        };
+
+        if(arg == "-h" || arg == "--help")
+            options.ShowHelp = true;
+        else if(arg == "-c" || arg == "--compress")
+            options.Mode = Operation::Compress;
+        else if(arg == "-x" || arg == "--decompress")
+            options.Mode = Operation::Decompress;
+        else if(arg == "-r" || arg == "--recursive")
+            options.Recursive = true;
+        else if(arg == "-o" || arg == "--output")
+            options.OutputDirectory = takeValue();
+        else if(arg == "-j" || arg == "--jobs")
+            options.Workers = parseCount(arg, takeValue());
+        else if(arg == "-t" || arg == "--threads")
+            options.CodecThreads = parseCount(arg, takeValue());
+        else if(arg == "--block-width")
+            options.BlockWidth = parseBlockWidth(arg, takeValue());
+        else if(arg == "--run-length")
+            options.RunLength = parseRunLength(arg, takeValue());
+        else if(arg == "--timeout")
+            options.TimeoutSeconds = parseCount(arg, takeValue());
+        else if(arg == "--report")
+            options.ReportPath = takeValue();
+        else if(arg == "--io-uring")
+            options.UseIoUring = true;
+        else if(!arg.empty() && arg[0] == '-')
+            throw std::invalid_argument("Unknown option: " + arg);
+        else
+            options.Inputs.push_back(arg);
+    }
+
+    if(!options.ShowHelp && options.Inputs.empty())
+        throw std::invalid_argument("No input files specified");
+
+    return options;
+}
+
+std::string getUsage()
+{
+    return
+        "Usage: pocketbook-cli [options] <file|directory|glob>...\n"
+        "\n"
+        "Description: Batch compressing/decompressing of 8bit '*.bmp' files\n"
+        "\n"
+        "Options:\n"
+        "  -h, --help             Displays this help.\n"
+        "  -c, --compress         Compress all inputs, directories are scanned for '*.bmp'.\n"
+        "  -x, --decompress       Decompress all inputs, directories are scanned for '*.barch'.\n"
+        "                         By default '*.barch' files are decompressed and others compressed.\n"
+        "  -r, --recursive        Scan directories recursively.\n"
+        "  -o, --output <dir>     Write results to <dir> instead of input directory.\n"
+        "  -j, --jobs <count>     Number of files converted at once, hardware threads by default.\n"
+        "  -t, --threads <count>  Threads used to convert single file, 1 by default, 0 - all.\n"
+        "  --block-width <0|4|8|16>  Pixels coded by a single code, 4 by default, 0 - chosen per file.\n"
+        "  --run-length <auto|off|on>  Run length coding inside rows, off by default.\n"
+        "                         Other than default block width and run length need readers with 'FRMT' support.\n"
+        "  --timeout <seconds>    Cancel files not converted within <seconds> of batch start.\n"
+        "  --report <file>        Write JSON report to <file> instead of stdout.\n"
+        "  --io-uring             Read and write files with io_uring when available.\n";
+}
+
+} // namespace PocketBook::Cli
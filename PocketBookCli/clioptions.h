@@ -0,0 +1,40 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include "../BmpLib/bmpoptions.h"
+
+#include <string>
+#include <vector>
+
+namespace PocketBook::Cli {
+
+enum class Operation
+{
+    Auto,       // By extension: '*.barch' is decompressed, other files are compressed
+    Compress,
+    Decompress
+};
+
+struct CliOptions
+{
+    std::vector<std::string> Inputs; // Files, directories or glob patterns
+    std::string OutputDirectory;     // Empty - outputs are placed next to inputs
+    std::string ReportPath;          // Empty - JSON report is printed to stdout
+    Operation Mode = Operation::Auto;
+    unsigned Workers = 0;            // Files converted at once, 0 - hardware concurrency
+    unsigned CodecThreads = 1;       // Threads used by compress/decompress of a single file
+    unsigned BlockWidth = 4;         // 0 - chosen per file, see CodecOptions::BlockWidth
+    RunLengthCoding RunLength = RunLengthCoding::Off;
+    unsigned TimeoutSeconds = 0;     // Unfinished files are cancelled after this time, 0 - no limit
+    bool Recursive = false;
+    bool UseIoUring = false;
+    bool ShowHelp = false;
+};
+
+// Throws std::invalid_argument when command line is malformed
+CliOptions parseCommandLine(int _argc, const char * const * _argv);
+
+std::string getUsage();
+
+} // namespace PocketBook::Cli
@@ -0,0 +1,172 @@
+// Copyright PocketBook - Interview Task
+
+#include "filecollector.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <set>
+#include <stdexcept>
+
+#ifdef __unix__
+#include <glob.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace PocketBook::Cli {
+
+namespace {
+
+const std::string COMPRESSED_EXTENSION = ".barch";
+const std::string UNCOMPRESSED_EXTENSION = ".bmp";
+const std::string UNPACKED_SUFFIX = "_unpacked";
+
+std::string getLowerExtension(const fs::path & _path)
+{
+    std::string extension = _path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char _c)
+    {
+        return static_cast<char>(std::tolower(_c));
+    });
+    return extension;
+}
+
+bool isCompressedFile(const fs::path & _path)
+{
+    return getLowerExtension(_path) == COMPRESSED_EXTENSION;
+}
+
+// Files found in directories are taken only when they match the operation
+bool isScannedFile(const fs::path & _path, Operation _mode)
+{
+    const std::string extension = getLowerExtension(_path);
+    switch(_mode)
+    {
+    case Operation::Compress:
+        return extension == UNCOMPRESSED_EXTENSION;
+    case Operation::Decompress:
+        return extension == COMPRESSED_EXTENSION;
+    default:
+        return extension == UNCOMPRESSED_EXTENSION || extension == COMPRESSED_EXTENSION;
+    }
+}
+
+std::vector<std::string> expandPattern(const std::string & _input)
+{
+#ifdef __unix__
+    if(_input.find_first_of("*?[") != std::string::npos)
+    {
+        std::vector<std::string> paths;
+        glob_t matches;
+        if(glob(_input.c_str(), 0, nullptr, &matches) == 0)
+        {
+            for(std::size_t i = 0; i < matches.gl_pathc; ++i)
+                paths.emplace_back(matches.gl_pathv[i]);
+        }
+        globfree(&matches);
+
+        if(paths.empty())
+            throw std::invalid_argument("No files match " + _input);
+        return paths;
+    }
+#endif
+
+    return { _input };
+}
+
+void scanDirectory(const fs::path & _directory, const CliOptions & _options, std::vector<fs::path> & _files)
+{
+    std::vector<fs::path> found;
+    auto addEntry = [&](const fs::directory_entry & _entry)
+    {
+        if(_entry.is_regular_file() && isScannedFile(_entry.path(), _options.Mode))
+            found.push_back(_entry.path());
+    };
+
+    if(_options.Recursive)
+    {
+        for(const auto & entry : fs::recursive_directory_iterator(_directory))
+            addEntry(entry);
+    }
+    else
+    {
+        for(const auto & entry : fs::directory_iterator(_directory))
+            addEntry(entry);
+    }
+
+    // Directory order is unspecified, the report follows file names
+    std::sort(found.begin(), found.end());
+    _files.insert(_files.end(), found.begin(), found.end());
+}
+
+BatchJob makeJob(const fs::path & _input, const CliOptions & _options)
+{
+    BatchJob job;
+    job.InputPath = _input.string();
+    job.Compress = _options.Mode == Operation::Auto ? !isCompressedFile(_input) : _options.Mode == Operation::Compress;
+
+    const fs::path directory = _options.OutputDirectory.empty() ? _input.parent_path() : fs::path(_options.OutputDirectory);
+    const std::string stem = _input.stem().string();
+    const std::string outputName = job.Compress ? stem + COMPRESSED_EXTENSION : stem + UNPACKED_SUFFIX + UNCOMPRESSED_EXTENSION;
+    job.OutputPath = (directory / outputName).string();
+
+    return job;
+}
+
+} // namespace
+
+std::vector<BatchJob> collectJobs(const CliOptions & _options)
+{
+    std::vector<fs::path> files;
+    for(const auto & input : _options.Inputs)
+    {
+        for(const auto & path : expandPattern(input))
+        {
+            std::error_code error;
+            if(fs::is_directory(path, error))
+                scanDirectory(path, _options, files);
+            else if(fs::is_regular_file(path, error))
+                files.emplace_back(path);
+            else
+                throw std::invalid_argument("Input doesn't exist: " + path);
+        }
+    }
+
+    // The same file given several times is converted once
+    std::vector<BatchJob> candidates;
+    std::set<fs::path> inputs;
+    std::set<fs::path> produced;
+    for(const auto & file : files)
+    {
+        const fs::path input = fs::weakly_canonical(file);
+        if(!inputs.insert(input).second)
+            continue;
+
+        candidates.push_back(makeJob(file, _options));
+        const fs::path output = fs::weakly_canonical(candidates.back().OutputPath);
+        if(output != input)
+            produced.insert(output);
+    }
+
+    // Input which is an output of another input is a result of previous run, it is
+    // regenerated instead of being converted back, so the same command can be repeated
+    std::vector<BatchJob> jobs;
+    for(const auto & job : candidates)
+    {
+        if(!produced.count(fs::weakly_canonical(job.InputPath)))
+            jobs.push_back(job);
+    }
+
+    std::set<fs::path> outputs;
+    for(const auto & job : jobs)
+    {
+        const fs::path output = fs::weakly_canonical(job.OutputPath);
+        if(output == fs::weakly_canonical(job.InputPath) || !outputs.insert(output).second)
+            throw std::invalid_argument("Output " + job.OutputPath + " conflicts with another input or output");
+    }
+
+    return jobs;
+}
+
+} // namespace PocketBook::Cli
@@ -0,0 +1,18 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include "clioptions.h"
+#include "../BmpLib/bmpbatch.h"
+
+#include <vector>
+
+namespace PocketBook::Cli {
+
+// Expands inputs into conversion jobs. Directories are scanned for files of the operation,
+// glob patterns are expanded on unix. Outputs are named like the GUI does:
+// '<name>.barch' for compression and '<name>_unpacked.bmp' for decompression.
+// Throws std::invalid_argument when input doesn't exist or output would overwrite another input.
+std::vector<BatchJob> collectJobs(const CliOptions & _options);
+
+} // namespace PocketBook::Cli
@@ -0,0 +1,173 @@
+// Copyright PocketBook - Interview Task
+
+#include "clioptions.h"
+#include "filecollector.h"
+#include "batchreport.h"
+#include "../BmpLib/bmpbatch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::uint64_t getFileSize(const std::string & _path)
+{
+    std::error_code error;
+    const auto size = fs::file_size(_path, error);
+    return error ? 0 : static_cast<std::uint64_t>(size);
+}
+
+double getSeconds(Clock::time_point _from, Clock::time_point _to)
+{
+    return std::chrono::duration<double>(_to - _from).count();
+}
+
+// Interrupted batch stops converting and removes unfinished outputs, the second signal terminates
+PocketBook::CancellationToken g_cancellation;
+
+extern "C" void onInterrupt(int _signal)
+{
+    g_cancellation.cancel();
+    std::signal(_signal, SIG_DFL);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    using namespace PocketBook;
+    using namespace PocketBook::Cli;
+
+    CliOptions options;
+    std::vector<BatchJob> jobs;
+    try
+    {
+        options = parseCommandLine(argc, argv);
+        if(options.ShowHelp)
+        {
+            std::cout << getUsage();
+            return 0;
+        }
+
+        jobs = collectJobs(options);
+        if(!options.OutputDirectory.empty())
+            fs::create_directories(options.OutputDirectory);
+    }
+    catch( const std::exception & _err )
+    {
+        std::cerr << "pocketbook-cli: " << _err.what() << "\n\n" << getUsage();
+        return 2;
+    }
+
+    const unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned workers = static_cast<unsigned>(std::max<std::size_t>(1, std::min<std::size_t>(
+        options.Workers ? options.Workers : hardwareThreads, jobs.size())));
+
+    const auto start = Clock::now();
+    std::signal(SIGINT, onInterrupt);
+    std::signal(SIGTERM, onInterrupt);
+
+    BatchOptions batchOptions;
+    batchOptions.Codec.ThreadCount = options.CodecThreads;
+    batchOptions.Codec.BlockWidth = options.BlockWidth;
+    batchOptions.Codec.RunLength = options.RunLength;
+    batchOptions.Codec.Cancellation = &g_cancellation;
+    if(options.TimeoutSeconds)
+        batchOptions.Codec.Deadline = start + std::chrono::seconds(options.TimeoutSeconds);
+    batchOptions.PreferIoUring = options.UseIoUring;
+
+    BatchReport report;
+    report.Workers = workers;
+    report.CodecThreads = options.CodecThreads ? options.CodecThreads : hardwareThreads;
+    report.Files.resize(jobs.size());
+
+    std::atomic<std::size_t> nextJob{0};
+    std::atomic<bool> usesIoUring{false};
+    std::mutex logMutex;
+
+    // Each worker owns its converter. Blocking converter takes files one by one from the shared queue,
+    // io_uring converter gets every workers-th file to keep several of them in flight.
+    auto worker = [&](unsigned _workerIndex)
+    {
+        BatchConverter converter(batchOptions);
+        const bool ioUring = converter.getBackend() == BatchIoBackend::IoUring;
+        if(ioUring)
+            usesIoUring = true;
+
+        std::vector<std::size_t> jobIndices;
+        auto onJobFinished = [&](std::size_t _index, const BatchJobResult & _result)
+        {
+            FileReport & file = report.Files[jobIndices[_index]];
+            file.Job = jobs[jobIndices[_index]];
+            file.Result = _result;
+            file.InputBytes = getFileSize(file.Job.InputPath);
+            file.OutputBytes = _result.Succeeded ? getFileSize(file.Job.OutputPath) : 0;
+            file.Seconds = _result.Seconds;
+
+            if(!_result.Succeeded)
+            {
+                std::lock_guard<std::mutex> lock(logMutex);
+                std::cerr << file.Job.InputPath << ": " << _result.ErrorMessage << "\n";
+            }
+        };
+
+        if(ioUring)
+        {
+            std::vector<BatchJob> workerJobs;
+            for(std::size_t index = _workerIndex; index < jobs.size(); index += workers)
+            {
+                jobIndices.push_back(index);
+                workerJobs.push_back(jobs[index]);
+            }
+            converter.run(workerJobs, onJobFinished);
+            return;
+        }
+
+        for(std::size_t index = nextJob++; index < jobs.size(); index = nextJob++)
+        {
+            jobIndices.assign(1, index);
+            converter.run({ jobs[index] }, onJobFinished);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(unsigned workerIndex = 1; workerIndex < workers; ++workerIndex)
+        threads.emplace_back(worker, workerIndex);
+    worker(0);
+    for(auto & thread : threads)
+        thread.join();
+    report.Seconds = getSeconds(start, Clock::now());
+    report.Backend = usesIoUring ? "io_uring" : "blocking";
+
+    if(options.ReportPath.empty())
+    {
+        writeJsonReport(std::cout, report);
+    }
+    else
+    {
+        std::ofstream reportFile(options.ReportPath);
+        writeJsonReport(reportFile, report);
+        if(!reportFile)
+        {
+            std::cerr << "pocketbook-cli: Unable to write report " << options.ReportPath << "\n";
+            return 1;
+        }
+    }
+
+    const bool allSucceeded = std::all_of(report.Files.begin(), report.Files.end(), [](const FileReport & _file)
+    {
+        return _file.Result.Succeeded;
+    });
+    return allSucceeded ? 0 : 1;
+}
@@ -4,93 +4,124 @@
 #include <QDir>
 
 #include "compressionmodel.h"
-#include "../BmpLib/bmpproxy.h"
-#include "../BmpLib/bmpexceptions.h"
+#include "compressionscheduler.h"
 
-#include <thread>
+#include <cassert>
 
 namespace PocketBook::Ui {
 
 CompressionModel::CompressionModel(QObject* _parent)
     : QObject(_parent)
 {
+    auto& scheduler = CompressionScheduler::instance();
+    connect(&scheduler, &CompressionScheduler::jobProgressChanged, this, &CompressionModel::onJobProgressChanged);
+    connect(&scheduler, &CompressionScheduler::jobFinished, this, &CompressionModel::onJobFinished);
+    connect(&scheduler, &CompressionScheduler::totalProgressChanged, this, &CompressionModel::onTotalProgressChanged);
 }
 
-void CompressionModel::compress(const QString& _filePath)
+int CompressionModel::compress(const QString& _filePath)
 {
     const QString extension = ".barch";
     const auto outFilePath = changeFileExtension(_filePath, extension);
     if(!removeFileIfExists(outFilePath))
     {
         emit errorOccured("Unable to complete operation");
-        return;
+        return -1;
     }
 
-    auto progressModel = m_progressModel;
-    assert(progressModel);
+    return submit(_filePath, outFilePath, true);
+}
 
-    std::thread worker {[_filePath, outFilePath, progressModel, this]
-    {
-        bool compressed = false;
-        QString errorMsg = "Unable to compress file";
-
-        try
-        {
-            progressModel->setText("Compressing");
-            auto bmpImage = BmpProxy::createFromBmp(_filePath.toStdString());
-            compressed = bmpImage.compress(outFilePath.toStdString(), progressModel);
-        }
-        catch( const FileError & _err )
-        {
-            errorMsg = QString(_err.what());
-        }
-        catch( ... )
-        {
-            errorMsg = QString("Unexpected Error");
-        }
-
-        if(!compressed)
-        {
-            emit errorOccured(errorMsg);
-        }
-    }};
-    worker.detach();
-}
-
-void CompressionModel::decompress(const QString& _filePath)
+int CompressionModel::decompress(const QString& _filePath)
 {
     const QString extension = ".bmp";
     auto outFilePath = getUniqueFilePath(_filePath, extension);
 
-    auto progressModel = m_progressModel;
+    return submit(_filePath, outFilePath, false);
+}
+
+void CompressionModel::cancel(int _jobId)
+{
+    if(m_jobIds.contains(_jobId))
+        CompressionScheduler::instance().cancel(_jobId);
+}
+
+void CompressionModel::cancelAll()
+{
+    for(const int jobId : std::as_const(m_jobIds))
+        CompressionScheduler::instance().cancel(jobId);
+}
+
+bool CompressionModel::isBusy() const
+{
+    return !m_jobIds.isEmpty();
+}
+
+QVariantMap CompressionModel::getLastStatistics() const
+{
+    return m_lastStatistics;
+}
+
+int CompressionModel::submit(const QString& _inFilePath, const QString& _outFilePath, bool _compress)
+{
     assert(m_progressModel);
 
-    std::thread worker {[_filePath, outFilePath, progressModel, this]
+    auto& scheduler = CompressionScheduler::instance();
+
+    // Shared progress model shows the whole batch of jobs, it is driven by scheduler's total progress
+    if(scheduler.getPendingJobCount() == 0)
+        m_progressModel->reset(0, 100);
+    m_progressModel->setText(_compress ? "Compressing" : "Decompressing");
+
+    CompressionScheduler::JobRequest request;
+    request.InputPath = _inFilePath;
+    request.OutputPath = _outFilePath;
+    request.Compress = _compress;
+    request.DemoThrottle = m_progressModel->getDemoThrottle();
+
+    const int jobId = scheduler.submit(request);
+    m_jobIds.insert(jobId);
+    if(m_jobIds.size() == 1)
+        emit busyChanged(true);
+
+    return jobId;
+}
+
+void CompressionModel::onJobProgressChanged(int _jobId, int _percent)
+{
+    if(m_jobIds.contains(_jobId))
+        emit jobProgressChanged(_jobId, _percent);
+}
+
+void CompressionModel::onJobFinished(int _jobId, bool _succeeded, const QString& _errorMessage, const QVariantMap& _statistics)
+{
+    if(!m_jobIds.remove(_jobId))
+        return;
+
+    if(_succeeded)
+    {
+        m_lastStatistics = _statistics;
+        emit lastStatisticsChanged();
+    }
+    else
     {
-        bool decompressed = false;
-        QString errorMsg = "Unable to decompress file";
-
-        try
-        {
-            progressModel->setText("Decompressing");
-            auto barchImage = BmpProxy::createFromBarch(_filePath.toStdString());
-            decompressed = barchImage.decompress(outFilePath.toStdString(), progressModel);
-        }
-        catch( const FileError & _err )
-        {
-            errorMsg = QString(_err.what());
-        }
-        catch( ... )
-        {
-            errorMsg = QString("Unexpected Error");
-        }
-
-        if(!decompressed)
-        {
-            emit errorOccured(errorMsg);
-        }
-    }};
-    worker.detach();
+        emit errorOccured(_errorMessage);
+    }
+
+    emit jobFinished(_jobId, _succeeded, _statistics);
+    if(m_jobIds.isEmpty())
+        emit busyChanged(false);
+
+    // Model of the last job of the batch completes shared progress, succeeded only without any failed job
+    const auto& scheduler = CompressionScheduler::instance();
+    if(m_progressModel && scheduler.getPendingJobCount() == 0)
+        m_progressModel->complete(scheduler.getFailedJobCount() == 0);
+}
+
+void CompressionModel::onTotalProgressChanged(int _percent)
+{
+    if(m_progressModel)
+        m_progressModel->setProgress(_percent);
 }
 
 ProgressModel* CompressionModel::getProgressModel()
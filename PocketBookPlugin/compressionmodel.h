@@ -3,6 +3,8 @@
 #pragma once
 
 #include <QObject>
+#include <QSet>
+#include <QVariantMap>
 #include <qqmlintegration.h>
 
 #include "progressmodel.h"
@@ -13,27 +15,51 @@ class CompressionModel : public QObject
 {
 Q_OBJECT
     Q_PROPERTY(ProgressModel* progressModel READ getProgressModel WRITE setProgressModel)
+    Q_PROPERTY(bool busy READ isBusy NOTIFY busyChanged)
+    Q_PROPERTY(QVariantMap lastStatistics READ getLastStatistics NOTIFY lastStatisticsChanged)
     QML_ELEMENT
 
 public:
     explicit CompressionModel(QObject* _parent = nullptr);
 
-    Q_INVOKABLE void compress(const QString& _filePath);
-    Q_INVOKABLE void decompress(const QString& _filePath);
+    // Jobs are queued in the shared CompressionScheduler, returned id is -1 if job wasn't queued
+    Q_INVOKABLE int compress(const QString& _filePath);
+    Q_INVOKABLE int decompress(const QString& _filePath);
+
+    // Cancels jobs queued by this model
+    Q_INVOKABLE void cancel(int _jobId);
+    Q_INVOKABLE void cancelAll();
+
+    bool isBusy() const;
+
+    // Statistics of the last succeeded job of this model, see CompressionScheduler::jobFinished
+    QVariantMap getLastStatistics() const;
 
 signals:
     void errorOccured(const QString& _text);
+    void jobProgressChanged(int _jobId, int _percent);
+    void jobFinished(int _jobId, bool _succeeded, const QVariantMap& _statistics);
+    void busyChanged(bool _busy);
+    void lastStatisticsChanged();
 
 private:
     void setProgressModel(ProgressModel* _model);
     ProgressModel* getProgressModel();
 
+    int submit(const QString& _inFilePath, const QString& _outFilePath, bool _compress);
+
+    void onJobProgressChanged(int _jobId, int _percent);
+    void onJobFinished(int _jobId, bool _succeeded, const QString& _errorMessage, const QVariantMap& _statistics);
+    void onTotalProgressChanged(int _percent);
+
     QString changeFileExtension(const QString& _filePath, const QString& _newExtension) const;
     bool removeFileIfExists(const QString& _filePath) const;
     QString getUniqueFilePath(const QString &_filePath, const QString& _newExtension) const;
 
 private:
     ProgressModel* m_progressModel = nullptr;
+    QSet<int> m_jobIds;
+    QVariantMap m_lastStatistics;
 };
 
 } // namespace PocketBook::Ui
@@ -0,0 +1,310 @@
+// Copyright PocketBook - Interview Task
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QThread>
+
+#include "compressionscheduler.h"
+#include "../BmpLib/bmpproxy.h"
+#include "../BmpLib/bmpexceptions.h"
+#include "../BmpLib/bmpinstrumentation.h"
+#include "../BmpLib/bmpprogress.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace PocketBook::Ui {
+
+namespace {
+
+class JobProgressNotifier : public AtomicProgressNotifier
+{
+public:
+    explicit JobProgressNotifier(int _demoThrottle)
+        : m_demoThrottle(_demoThrottle)
+    {
+    }
+
+    ProgressPolicy getProgressPolicy() const override
+    {
+        ProgressPolicy policy = AtomicProgressNotifier::getProgressPolicy();
+        policy.DemoThrottle = std::chrono::milliseconds(m_demoThrottle);
+        return policy;
+    }
+
+private:
+    int m_demoThrottle;
+};
+
+QVariantMap toVariantMap(const OperationStatistics& _statistics)
+{
+    return {
+        { "compress", _statistics.Compress },
+        { "totalSeconds", _statistics.TotalSeconds },
+        { "codecSeconds", _statistics.CodecSeconds },
+        { "writeSeconds", _statistics.WriteSeconds },
+        { "bytesRead", static_cast<qulonglong>(_statistics.BytesRead) },
+        { "bytesWritten", static_cast<qulonglong>(_statistics.BytesWritten) },
+        { "blockWidth", _statistics.BlockWidth },
+        { "runLength", _statistics.RunLength },
+        { "rows", static_cast<qulonglong>(_statistics.Rows) },
+        { "whiteRows", static_cast<qulonglong>(_statistics.WhiteRows) },
+        { "whiteBlocks", static_cast<qulonglong>(_statistics.WhiteBlocks) },
+        { "blackBlocks", static_cast<qulonglong>(_statistics.BlackBlocks) },
+        { "literalBlocks", static_cast<qulonglong>(_statistics.LiteralBlocks) },
+        { "peakBufferBytes", static_cast<qulonglong>(_statistics.PeakBufferBytes) },
+        { "compressionRatio", _statistics.getCompressionRatio() },
+        { "throughputMBps", _statistics.getThroughput() },
+    };
+}
+
+} // namespace
+
+struct CompressionScheduler::Job
+{
+    explicit Job(int _id, const JobRequest& _request)
+        : Id(_id)
+        , Request(_request)
+        , Progress(_request.DemoThrottle)
+    {
+    }
+
+    const int Id;
+    const JobRequest Request;
+
+    // Shared with pool thread
+    JobProgressNotifier Progress;
+    CancellationToken Cancellation;
+
+    // Used only on GUI thread
+    bool Started = false;
+    int LastPercent = -1;
+};
+
+CompressionScheduler& CompressionScheduler::instance()
+{
+    static CompressionScheduler* scheduler = new CompressionScheduler(QCoreApplication::instance());
+    return *scheduler;
+}
+
+CompressionScheduler::CompressionScheduler(QObject* _parent)
+    : QObject(_parent)
+{
+    // Each job is converted by a single codec thread, so one job per hardware thread
+    m_pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+
+    m_pollTimer.setInterval(16); // Enough for smooth progress bar animation
+    connect(&m_pollTimer, &QTimer::timeout, this, &CompressionScheduler::poll);
+}
+
+CompressionScheduler::~CompressionScheduler()
+{
+    // Pool threads post to this object, nothing must run after it is gone
+    cancelAll();
+    m_pool.waitForDone();
+}
+
+int CompressionScheduler::submit(const JobRequest& _request)
+{
+    const int jobId = m_nextJobId++;
+    auto job = std::make_shared<Job>(jobId, _request);
+    m_jobs.insert(jobId, job);
+
+    ++m_batchJobCount;
+    if(!m_pollTimer.isActive())
+        m_pollTimer.start();
+
+    m_pool.start([this, job]
+    {
+        runJob(job);
+    });
+
+    return jobId;
+}
+
+void CompressionScheduler::cancel(int _jobId)
+{
+    const auto job = m_jobs.value(_jobId);
+    if(job)
+        job->Cancellation.cancel();
+}
+
+void CompressionScheduler::cancelAll()
+{
+    for(const auto& job : std::as_const(m_jobs))
+        job->Cancellation.cancel();
+}
+
+int CompressionScheduler::getJobProgress(int _jobId) const
+{
+    const auto job = m_jobs.value(_jobId);
+    return job ? job->Progress.getPercent() : -1;
+}
+
+int CompressionScheduler::getMaxThreadCount() const
+{
+    return m_pool.maxThreadCount();
+}
+
+int CompressionScheduler::getPendingJobCount() const
+{
+    return static_cast<int>(m_jobs.size());
+}
+
+int CompressionScheduler::getTotalProgress() const
+{
+    if(m_batchJobCount == 0)
+        return 100;
+
+    long long total = m_batchSucceededCount * 100LL;
+    for(const auto& job : std::as_const(m_jobs))
+    {
+        if(job->Started)
+            total += job->Progress.getPercent();
+    }
+
+    return static_cast<int>(total / m_batchJobCount);
+}
+
+int CompressionScheduler::getFailedJobCount() const
+{
+    return m_batchFailedCount;
+}
+
+void CompressionScheduler::runJob(const std::shared_ptr<Job>& _job)
+{
+    const JobRequest& request = _job->Request;
+    bool succeeded = false;
+    QVariantMap statistics;
+    QString errorMsg = request.Compress ? "Unable to compress file" : "Unable to decompress file";
+
+    if(_job->Cancellation.isCancelled())
+    {
+        errorMsg = "Operation cancelled";
+    }
+    else
+    {
+        QMetaObject::invokeMethod(this, [this, jobId = _job->Id]
+        {
+            onJobStarted(jobId);
+        }, Qt::QueuedConnection);
+
+        // Cancelled job stops at the next row and removes its output
+        OperationStatistics operationStatistics;
+        CodecOptions options;
+        options.Cancellation = &_job->Cancellation;
+        options.Statistics = &operationStatistics;
+
+        try
+        {
+            if(request.Compress)
+            {
+                auto bmpImage = BmpProxy::createFromBmp(request.InputPath.toStdString());
+                succeeded = bmpImage.compress(request.OutputPath.toStdString(), &_job->Progress, options);
+            }
+            else
+            {
+                auto barchImage = BmpProxy::createFromBarch(request.InputPath.toStdString());
+                succeeded = barchImage.decompress(request.OutputPath.toStdString(), &_job->Progress, options);
+            }
+        }
+        catch( const FileError & _err )
+        {
+            errorMsg = QString(_err.what());
+        }
+        catch( ... )
+        {
+            errorMsg = QString("Unexpected Error");
+        }
+
+        if(!succeeded && _job->Cancellation.isCancelled())
+            errorMsg = "Operation cancelled";
+        if(succeeded)
+            statistics = toVariantMap(operationStatistics);
+    }
+
+    QMetaObject::invokeMethod(this, [this, jobId = _job->Id, succeeded, errorMsg, statistics]
+    {
+        onJobFinished(jobId, succeeded, succeeded ? QString() : errorMsg, statistics);
+    }, Qt::QueuedConnection);
+}
+
+void CompressionScheduler::onJobStarted(int _jobId)
+{
+    const auto job = m_jobs.value(_jobId);
+    assert(job);
+
+    job->Started = true;
+    emit jobStarted(_jobId);
+}
+
+void CompressionScheduler::onJobFinished(int _jobId, bool _succeeded, const QString& _errorMessage, const QVariantMap& _statistics)
+{
+    const auto job = m_jobs.take(_jobId);
+    assert(job);
+
+    if(_succeeded)
+    {
+        ++m_batchSucceededCount;
+        qInfo().nospace() << (job->Request.Compress ? "Compressed " : "Decompressed ") << job->Request.InputPath
+            << ": " << _statistics.value("totalSeconds").toDouble() * 1e3 << " ms"
+            << " (codec " << _statistics.value("codecSeconds").toDouble() * 1e3 << " ms"
+            << ", write " << _statistics.value("writeSeconds").toDouble() * 1e3 << " ms)"
+            << ", ratio " << _statistics.value("compressionRatio").toDouble()
+            << ", block width " << _statistics.value("blockWidth").toUInt()
+            << (_statistics.value("runLength").toBool() ? " with runs" : "")
+            << ", rows " << _statistics.value("rows").toULongLong()
+            << " (white " << _statistics.value("whiteRows").toULongLong() << ")"
+            << ", blocks white " << _statistics.value("whiteBlocks").toULongLong()
+            << " black " << _statistics.value("blackBlocks").toULongLong()
+            << " literal " << _statistics.value("literalBlocks").toULongLong()
+            << ", peak buffers " << _statistics.value("peakBufferBytes").toULongLong() << " bytes";
+    }
+    else
+    {
+        ++m_batchFailedCount;
+        qInfo().nospace() << "Failed " << job->Request.InputPath << ": " << _errorMessage;
+    }
+
+    // Failed or cancelled job reports only through jobFinished, its progress stays where it stopped
+    if(_succeeded)
+        emit jobProgressChanged(_jobId, 100);
+    // Total progress of the finished job is delivered before its result
+    poll();
+    emit jobFinished(_jobId, _succeeded, _errorMessage, _statistics);
+
+    if(m_jobs.isEmpty())
+    {
+        m_pollTimer.stop();
+        m_batchJobCount = 0;
+        m_batchSucceededCount = 0;
+        m_batchFailedCount = 0;
+        m_lastTotalPercent = -1;
+        emit allJobsFinished();
+    }
+}
+
+void CompressionScheduler::poll()
+{
+    for(const auto& job : std::as_const(m_jobs))
+    {
+        if(!job->Started)
+            continue;
+
+        const int percent = job->Progress.getPercent();
+        if(percent != job->LastPercent)
+        {
+            job->LastPercent = percent;
+            emit jobProgressChanged(job->Id, percent);
+        }
+    }
+
+    const int totalPercent = getTotalProgress();
+    if(totalPercent != m_lastTotalPercent)
+    {
+        m_lastTotalPercent = totalPercent;
+        emit totalProgressChanged(totalPercent);
+    }
+}
+
+} // namespace PocketBook::Ui
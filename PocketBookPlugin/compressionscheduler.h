@@ -0,0 +1,90 @@
+// Copyright PocketBook - Interview Task
+
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVariantMap>
+
+#include <memory>
+
+namespace PocketBook::Ui {
+
+// Shared queue of compression jobs for all CompressionModel instances.
+// Jobs run on a pool bounded by the number of hardware threads, so bulk
+// requests from UI don't oversubscribe cores and disk.
+class CompressionScheduler : public QObject
+{
+Q_OBJECT
+
+public:
+    struct JobRequest
+    {
+        QString InputPath;
+        QString OutputPath;
+        bool Compress = true;
+        int DemoThrottle = 0; // Milliseconds after each processed row
+    };
+
+    // Created on first use and owned by application object
+    static CompressionScheduler& instance();
+
+    // Returns job id, the job is started as soon as a pool thread is free
+    int submit(const JobRequest& _request);
+
+    // Queued job is skipped, running job stops at the next row and removes its output
+    void cancel(int _jobId);
+    void cancelAll();
+
+    // Percent of the job, -1 for unknown or finished job
+    int getJobProgress(int _jobId) const;
+
+    int getMaxThreadCount() const;
+    int getPendingJobCount() const;
+
+    // Progress of all jobs submitted since the scheduler was idle last time, only succeeded
+    // jobs count as complete, so the batch reaches 100 only when all its jobs succeed
+    int getTotalProgress() const;
+
+    // Failed and cancelled jobs of the current batch, valid until allJobsFinished
+    int getFailedJobCount() const;
+
+signals:
+    void jobStarted(int _jobId);
+    void jobProgressChanged(int _jobId, int _percent);
+    // Statistics keys match OperationStatistics fields in lower camel case, empty map if job wasn't run
+    void jobFinished(int _jobId, bool _succeeded, const QString& _errorMessage, const QVariantMap& _statistics);
+    void totalProgressChanged(int _percent);
+    void allJobsFinished();
+
+private:
+    struct Job;
+
+    explicit CompressionScheduler(QObject* _parent = nullptr);
+    ~CompressionScheduler() override;
+
+    // Runs on pool thread
+    void runJob(const std::shared_ptr<Job>& _job);
+
+    void onJobStarted(int _jobId);
+    void onJobFinished(int _jobId, bool _succeeded, const QString& _errorMessage, const QVariantMap& _statistics);
+    void poll();
+
+private:
+    QThreadPool m_pool;
+    QHash<int, std::shared_ptr<Job>> m_jobs;
+    int m_nextJobId = 1;
+
+    // Succeeded jobs of the current batch count as complete in total progress
+    int m_batchJobCount = 0;
+    int m_batchSucceededCount = 0;
+    int m_batchFailedCount = 0;
+    int m_lastTotalPercent = -1;
+
+    // Progress of running jobs is read from atomics by timer
+    QTimer m_pollTimer;
+};
+
+} // namespace PocketBook::Ui
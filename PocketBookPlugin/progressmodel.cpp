@@ -9,16 +9,34 @@ ProgressModel::ProgressModel(QObject* _parent)
 {
 }
 
-void ProgressModel::init(int _min, int _max)
+void ProgressModel::reset(int _min, int _max)
 {
-    m_minValue = _min;
-    m_maxValue = _max;
+    if(m_minValue != _min)
+    {
+        m_minValue = _min;
+        emit minValueChanged(m_minValue);
+    }
+    if(m_maxValue != _max)
+    {
+        m_maxValue = _max;
+        emit maxValueChanged(m_maxValue);
+    }
+    m_lastPercent = -1;
+}
+
+void ProgressModel::setProgress(int _current)
+{
+    const int percent = m_maxValue > m_minValue ? (_current - m_minValue) * 100 / (m_maxValue - m_minValue) : 100;
+    if(percent != m_lastPercent)
+    {
+        m_lastPercent = percent;
+        emit progressChanged(percent);
+    }
 }
 
-void ProgressModel::notifyProgress(int _current)
+void ProgressModel::complete(bool _succeeded)
 {
-    const int percent = _current * 100 / m_maxValue;
-    emit progressChanged(percent);
+    emit completed(_succeeded);
 }
 
 int ProgressModel::min() const
@@ -45,5 +63,19 @@ void ProgressModel::setText(const QString & _text)
     }
 }
 
+int ProgressModel::getDemoThrottle() const
+{
+    return m_demoThrottle;
+}
+
+void ProgressModel::setDemoThrottle(int _milliseconds)
+{
+    if( m_demoThrottle != _milliseconds )
+    {
+        m_demoThrottle = _milliseconds;
+        emit demoThrottleChanged(m_demoThrottle);
+    }
+}
+
 } // namespacace PocketBook::Ui
 
@@ -5,26 +5,29 @@
 #include <QObject>
 #include <qqmlintegration.h>
 
-#include "../BmpLib/bmputils.h"
-
 #include <iostream>
 
 namespace PocketBook::Ui {
 
-class ProgressModel
-    : public QObject, public IProgressNotifier
+// Progress shown by the shared progress bar, updated on GUI thread by its owner
+class ProgressModel : public QObject
 {
 Q_OBJECT
     Q_PROPERTY(int min READ min NOTIFY minValueChanged);
     Q_PROPERTY(int max READ max NOTIFY maxValueChanged);
     Q_PROPERTY(QString text READ getText WRITE setText NOTIFY textChanged)
+    Q_PROPERTY(int demoThrottle READ getDemoThrottle WRITE setDemoThrottle NOTIFY demoThrottleChanged)
     QML_ELEMENT
 
 public:
     explicit ProgressModel(QObject* _parent = nullptr);
 
-    void init(int _min, int _max) override;
-    void notifyProgress(int _current) override;
+    // Starts new progress, progressChanged is emitted for every changed percent of it
+    void reset(int _min, int _max);
+    void setProgress(int _current);
+
+    // Ends the progress, completed is the only notification that all work is done
+    void complete(bool _succeeded);
 
     int min() const;
     int max() const;
@@ -32,17 +35,26 @@ public:
     const QString & getText() const;
     void setText(const QString & _text);
 
+    int getDemoThrottle() const;
+    void setDemoThrottle(int _milliseconds);
+
 signals:
     void progressChanged(int);
+    void completed(bool _succeeded);
     void minValueChanged(int);
     void maxValueChanged(int);
     void textChanged(QString const &);
+    void demoThrottleChanged(int);
 
 private:
     // Default values equal to the percents from 0 to 100.
     int m_minValue = 0;
     int m_maxValue = 100;
+    int m_lastPercent = -1;
     QString m_text = QString();
+
+    // Delay in milliseconds after each processed row, used only for progress demonstration
+    int m_demoThrottle = 0;
 };
 
 } // namespace PocketBook::Ui
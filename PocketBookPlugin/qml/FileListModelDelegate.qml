@@ -36,15 +36,20 @@ Item {
         MouseArea {
             id: mouseArea
 
-            acceptedButtons: Qt.LeftButton
+            acceptedButtons: Qt.LeftButton | Qt.RightButton
             anchors.fill: parent
             hoverEnabled: true
 
             drag.target: Item {
             }
 
-            onClicked: {
-                if (fileName.endsWith(".barch")) {
+            onClicked: (mouse) => {
+                // Right click cancels jobs of this file, left click is ignored while they run
+                if (mouse.button === Qt.RightButton) {
+                    compressionModel.cancelAll();
+                } else if (compressionModel.busy) {
+                    return;
+                } else if (fileName.endsWith(".barch")) {
                     compressionModel.decompress(filePath);
                 } else if(fileName.endsWith(".bmp")) {
                     compressionModel.compress(filePath);
@@ -117,15 +122,6 @@ Item {
             to: 1.0
         }
     }
-    Connections {
-         target: progressModel
-        function onProgressChanged(value) {
-            if (value < progressModel.max) {
-                mouseArea.enabled = false;
-            }
-        }
-    }
-
     Connections {
         target: compressionModel
         function onErrorOccured(text) {
@@ -25,6 +25,12 @@ int main(int argc, char *argv[])
         ,	QCoreApplication::translate("main", "Scan bmp, barch and png files in <directory>.")
         ,	QCoreApplication::translate("main", "directory"));
     parser.addOption(dirOption);
+    QCommandLineOption throttleOption(
+        QStringList() << "t" << "throttle"
+        ,	QCoreApplication::translate("main", "Delay in <milliseconds> after each processed row to demonstrate progress.")
+        ,	QCoreApplication::translate("main", "milliseconds")
+        ,	"0");
+    parser.addOption(throttleOption);
 
     // Process the actual command line arguments given by the user
     parser.process(app);
@@ -38,9 +44,12 @@ int main(int argc, char *argv[])
             directoryToScanPath = targetDir;
     }
 
+    const int progressThrottle = qMax(0, parser.value(throttleOption).toInt());
+
     QQuickView view;
     QQmlContext* context = view.rootContext();
     context->setContextProperty("initialFolder", directoryToScanPath);
+    context->setContextProperty("progressThrottle", progressThrottle);
 #ifdef Q_OS_MACOS
     view.engine()->addImportPath(app.applicationDirPath() + "/../PlugIns");
 #endif